@@ -1,18 +1,161 @@
 #include "provided.h"
-#include "MyMap.h"
+#include "support.h"
+#include "MapSnapshot.h"
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
 using namespace std;
 
+namespace {
+
+    char lower(char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); }
+
+        //the three characters starting at s, packed into one key
+    uint32_t gramAt(const char* s) {
+        return (static_cast<uint32_t>(static_cast<unsigned char>(s[0])) << 16) |
+               (static_cast<uint32_t>(static_cast<unsigned char>(s[1])) << 8) |
+                static_cast<uint32_t>(static_cast<unsigned char>(s[2]));
+    }
+
+        //a word is a run of letters and digits
+    bool isWordStart(const char* name, size_t pos) {
+        return isalnum(static_cast<unsigned char>(name[pos])) &&
+               (pos == 0 || !isalnum(static_cast<unsigned char>(name[pos-1])));
+    }
+    
+        //edit distance (insertions, deletions, substitutions and swaps of neighbours) between
+        //q and the closest prefix of s[0, n), or limit+1 if it is more than limit
+    int prefixDistance(const char* s, size_t n, const string& q, int limit) {
+        
+        size_t m = q.size();
+        vector<int> before(m + 1), prev(m + 1), curr(m + 1);    //columns j-2, j-1 and j
+        for (size_t i = 0; i <= m; i++)
+            prev[i] = static_cast<int>(i);
+        int best = prev[m];
+        
+        for (size_t j = 1; j <= n && j <= m + limit; j++) {
+            curr[0] = static_cast<int>(j);
+            int least = curr[0];
+            for (size_t i = 1; i <= m; i++) {
+                int d = min(min(prev[i] + 1, curr[i-1] + 1), prev[i-1] + (q[i-1] == s[j-1] ? 0 : 1));
+                if (i > 1 && j > 1 && q[i-1] == s[j-2] && q[i-2] == s[j-1])
+                    d = min(d, before[i-2] + 1);
+                curr[i] = d;
+                least = min(least, d);
+            }
+            best = min(best, curr[m]);
+            if (least > limit)
+                break;
+            before.swap(prev);
+            prev.swap(curr);
+        }
+        return min(best, limit + 1);
+    }
+    
+        //the group of complete's results lowercased name falls in for query q (0 to 3, as they are
+        //offered), or -1 if none; typos is set to the number of typos, which is 0 but in group 3.
+        //This is what the indexes work out for the names they hold, one name at a time
+    int matchGroup(const string& name, const string& q, int& typos) {
+        
+        typos = 0;
+        if (name.compare(0, q.size(), q) == 0)
+            return 0;
+        
+        bool inside = false;
+        for (size_t pos = name.find(q); pos != string::npos; pos = name.find(q, pos + 1)) {
+            if (isWordStart(name.data(), pos))
+                return 1;
+            inside = true;
+        }
+        if (inside && q.size() >= 3)
+            return 2;
+        
+        if (q.size() < 4)
+            return -1;
+        int limit = q.size() >= 8 ? 2 : 1;
+        typos = limit + 1;
+        for (size_t pos = 0; pos < name.size(); pos++)
+            if (isWordStart(name.data(), pos) && (name[pos] == q[0] || name[pos] == q[1]))
+                typos = min(typos, prefixDistance(name.data() + pos, name.size() - pos, q, limit));
+        return typos <= limit ? 3 : -1;
+    }
+}
+
 class AttractionMapperImpl
 {
 public:
 	AttractionMapperImpl();
 	~AttractionMapperImpl();
 	void init(const MapLoader& ml);
-	bool getGeoCoord(string attraction, GeoCoord& gc) const;
+	bool getGeoCoord(const string& attraction, GeoCoord& gc) const;
+	bool getGeoCoord(const string& attraction, FixedCoord& fc) const;
+    vector<string> complete(const string& text, size_t k) const;
+    int getSegmentId(const string& attraction) const;
+    void addAttraction(const string& name, const FixedCoord& fc, int segment);
+    bool removeAttraction(const string& name);
+    void save(SnapshotWriter& w) const;
     
 private:
-    MyMap<string, GeoCoord> m_map;
+        //lowercased names in sorted order, so lookups are a binary search and the index can live in a snapshot
+    NameTable m_names;
+    NameTable m_display;                    //each name in m_names as the map spells it
+    FlatArray<FixedCoord> m_coords;         //coordinate of each name in m_names
+    FlatArray<int32_t> m_segments;          //segment each name in m_names is on
+    NumberTexts m_texts;                    //the map's, copied: how its coordinates were written
+    
+        //trigram index for matches inside names: every distinct three characters of the
+        //lowercased names, sorted, and for each the names holding it, in m_names order
+    FlatArray<uint32_t> m_grams;
+    FlatArray<int32_t> m_gramOffsets;       //names of m_grams[g] are [m_gramOffsets[g], m_gramOffsets[g+1])
+    FlatArray<int32_t> m_gramNames;
+    
+        //every word of every name, sorted by the text from the word's start to the end of the
+        //name, so the words starting with some text are together and can be walked like a trie
+    struct WordStart {
+        int32_t m_name;                     // index into m_names
+        int32_t m_pos;                      // offset of the word in the name
+    };
+    FlatArray<WordStart> m_words;
+    
+        //state of a walk over m_words for words starting within limit typos of query
+    struct FuzzyWalk {
+        string query;
+        int limit;
+        vector<int> rows;                   // edit distance rows, query.size()+1 for each depth
+        vector<pair<int, int>> matches;     // (typos, name), a name possibly more than once
+    };
+    
+        //attractions added since the indexes were built, sorted by lowercased name and matched
+        //one by one, and the names in m_names they replace or that have been removed
+    struct AddedName {
+        string      m_key;                  // lowercased
+        string      m_display;
+        FixedCoord  m_coord;
+        int32_t     m_segment;
+    };
+    vector<AddedName> m_added;
+    vector<int32_t> m_hidden;               // sorted
+    
+    /* private member functions */
+    
+        //finds attraction among the names in m_names (setting base) or in m_added (setting added)
+    bool find(const string& attraction, int& base, int& added) const;
+    bool hidden(int id) const { return !m_hidden.empty() && binary_search(m_hidden.begin(), m_hidden.end(), id); }
+    
+        //the character of word w at depth d, or -1 past the end of its name
+    int charAt(const WordStart& w, size_t d) const;
+        //the words in [first, last), which agree on their first depth characters, extended by one character
+    void walk(FuzzyWalk& fw, int first, int last, size_t depth, int found) const;
+    
+        //index of the first name not less than s, comparing s as if it were lowercased
+    int lowerBound(const string& s) const;
+        //sets [first, last) to the names holding gram; false if there are none
+    bool postings(uint32_t gram, const int32_t*& first, const int32_t*& last) const;
+    void buildGrams();
+    void buildWords();
 };
 
 AttractionMapperImpl::AttractionMapperImpl()
@@ -25,35 +168,448 @@ AttractionMapperImpl::~AttractionMapperImpl()
 
 void AttractionMapperImpl::init(const MapLoader& ml)
 {
-    for (int i = 0; i < ml.getNumSegments(); i++) {
+    const MapSnapshot* snap = ml.getSnapshot();
+    if (snap != nullptr && snap->get(SNAP_ATTINDEX_CHARS, m_names.m_chars) &&
+        snap->get(SNAP_ATTINDEX_OFFSETS, m_names.m_offsets) && snap->get(SNAP_ATTINDEX_COORDS, m_coords) &&
+        snap->get(SNAP_ATTINDEX_DISPLAY_CHARS, m_display.m_chars) &&
+        snap->get(SNAP_ATTINDEX_DISPLAY_OFFSETS, m_display.m_offsets) && snap->get(SNAP_ATTINDEX_GRAMS, m_grams) &&
+        snap->get(SNAP_ATTINDEX_GRAM_OFFSETS, m_gramOffsets) && snap->get(SNAP_ATTINDEX_GRAM_NAMES, m_gramNames) &&
+        snap->get(SNAP_ATTINDEX_WORDS, m_words) && snap->get(SNAP_ATTINDEX_SEGMENTS, m_segments)) {
+        m_texts.copy(ml.getTables().numberTexts);
+        m_added.clear();
+        m_hidden.clear();
+        return;                                             //index was compiled into the snapshot
+    }
+    
+    const MapTables& tables = ml.getTables();
+    m_texts.copy(tables.numberTexts);
+    m_added.clear();
+    m_hidden.clear();
+    
+    vector<int> segmentOf(tables.attractions.size(), -1);   //segment each attraction record belongs to
+    for (size_t i = 0; i < tables.segments.size(); i++) {
+        const SegmentRecord& seg = tables.segments[i];
+        for (int j = 0; j < seg.numAttractions; j++)
+            segmentOf[seg.firstAttraction + j] = static_cast<int>(i);
+    }
+    
+    vector<pair<string, int>> entries;                      //(lowercase name, attraction record)
+    
+    for (size_t i = 0; i < tables.attractions.size(); i++) {
+        
+        string name = tables.names.get(tables.attractions[i].name);
+        for (size_t k = 0; k < name.size(); k++)            //make lowercase
+            name[k] = lower(name[k]);
+        
+        entries.push_back(make_pair(name, static_cast<int>(i)));
+    }
+    
+    sort(entries.begin(), entries.end());
+    
+    vector<string> names;
+    vector<string> display;
+    vector<FixedCoord> coords;
+    vector<int32_t> segments;
+    
+    for (size_t i = 0; i < entries.size(); i++) {
         
-        StreetSegment seg;
-        ml.getSegment(i, seg);
+        if (i + 1 < entries.size() && entries[i+1].first == entries[i].first)
+            continue;                                       //a later attraction with the same name wins
         
-        for (int j = 0; j < seg.attractions.size(); j++) {
-            
-            string name = seg.attractions[j].name;
-            for (int k = 0; k < name.size(); k++)       //make lowercase
-                name[k] = tolower(name[k]);
-            
-            m_map.associate(name, seg.attractions[j].geocoordinates);
+        const AttractionRecord& rec = tables.attractions[entries[i].second];
+        names.push_back(move(entries[i].first));
+        display.push_back(tables.names.get(rec.name));
+        coords.push_back(rec.coord);
+        segments.push_back(segmentOf[entries[i].second]);
+    }
+    
+    m_names.build(names);
+    m_display.build(display);
+    m_coords.adopt(coords);
+    m_segments.adopt(segments);
+    buildGrams();
+    buildWords();
+}
+
+void AttractionMapperImpl::buildGrams()
+{
+    vector<pair<uint32_t, int32_t>> pairs;                  //(gram, name), one for each gram of each name
+    
+    for (int id = 0; id < m_names.size(); id++) {
+        const char* name = m_names.data(id);
+        for (size_t i = 0; i + 3 <= m_names.length(id); i++)
+            pairs.push_back(make_pair(gramAt(name + i), id));
+    }
+    
+    sort(pairs.begin(), pairs.end());
+    pairs.erase(unique(pairs.begin(), pairs.end()), pairs.end());
+    
+    vector<uint32_t> grams;
+    vector<int32_t> offsets;
+    vector<int32_t> gramNames;
+    
+    for (size_t i = 0; i < pairs.size(); i++) {
+        if (i == 0 || pairs[i].first != pairs[i-1].first) {
+            grams.push_back(pairs[i].first);
+            offsets.push_back(static_cast<int32_t>(gramNames.size()));
         }
+        gramNames.push_back(pairs[i].second);
     }
+    offsets.push_back(static_cast<int32_t>(gramNames.size()));
+    
+    m_grams.adopt(grams);
+    m_gramOffsets.adopt(offsets);
+    m_gramNames.adopt(gramNames);
+}
+
+void AttractionMapperImpl::buildWords()
+{
+    vector<WordStart> words;
+    for (int id = 0; id < m_names.size(); id++)
+        for (size_t pos = 0; pos < m_names.length(id); pos++)
+            if (isWordStart(m_names.data(id), pos)) {
+                WordStart w = { id, static_cast<int32_t>(pos) };
+                words.push_back(w);
+            }
+    
+    sort(words.begin(), words.end(), [this](const WordStart& a, const WordStart& b) {
+        size_t lenA = m_names.length(a.m_name) - a.m_pos;
+        size_t lenB = m_names.length(b.m_name) - b.m_pos;
+        int c = memcmp(m_names.data(a.m_name) + a.m_pos, m_names.data(b.m_name) + b.m_pos, min(lenA, lenB));
+        if (c != 0)
+            return c < 0;
+        return lenA != lenB ? lenA < lenB : a.m_name < b.m_name;
+    });
+    
+    m_words.adopt(words);
 }
 
-bool AttractionMapperImpl::getGeoCoord(string attraction, GeoCoord& gc) const
+bool AttractionMapperImpl::getGeoCoord(const string& attraction, GeoCoord& gc) const
 {
-    for (int i = 0; i < attraction.size(); i++)         //make lowercase
-        attraction[i] = tolower(attraction[i]);
+    FixedCoord fc;
+    if (!getGeoCoord(attraction, fc))
+        return false;
     
-    const GeoCoord* temp = m_map.find(attraction);
-    if (temp == nullptr)
+    gc = m_texts.geoCoord(fc);
+	return true;
+}
+
+bool AttractionMapperImpl::getGeoCoord(const string& attraction, FixedCoord& fc) const
+{
+    int base, added;
+    if (!find(attraction, base, added))
         return false;
     
-    gc = *temp;
+    fc = base != -1 ? m_coords[base] : m_added[added].m_coord;
 	return true;
 }
 
+int AttractionMapperImpl::getSegmentId(const string& attraction) const
+{
+    int base, added;
+    if (!find(attraction, base, added))
+        return -1;
+    
+    return base != -1 ? m_segments[base] : m_added[added].m_segment;
+}
+
+void AttractionMapperImpl::addAttraction(const string& name, const FixedCoord& fc, int segment)
+{
+    AddedName entry = { name, name, fc, segment };
+    for (size_t i = 0; i < entry.m_key.size(); i++)
+        entry.m_key[i] = lower(entry.m_key[i]);
+    
+    int base, added;
+    if (find(name, base, added)) {                          //it replaces the attraction of that name
+        if (base != -1)
+            m_hidden.insert(lower_bound(m_hidden.begin(), m_hidden.end(), base), base);
+        else {
+            m_added[added] = entry;
+            return;
+        }
+    }
+    
+    auto at = lower_bound(m_added.begin(), m_added.end(), entry,
+                          [](const AddedName& a, const AddedName& b) { return a.m_key < b.m_key; });
+    m_added.insert(at, entry);
+}
+
+bool AttractionMapperImpl::removeAttraction(const string& name)
+{
+    int base, added;
+    if (!find(name, base, added))
+        return false;
+    
+    if (base != -1)
+        m_hidden.insert(lower_bound(m_hidden.begin(), m_hidden.end(), base), base);
+    else
+        m_added.erase(m_added.begin() + added);
+    return true;
+}
+
+vector<string> AttractionMapperImpl::complete(const string& text, size_t k) const
+{
+    string q = text;
+    for (size_t i = 0; i < q.size(); i++)
+        q[i] = lower(q[i]);
+    
+    if (q.empty() || k == 0)
+        return vector<string>();
+    
+        //a name is its index in m_names, or ~i for m_added[i]; each group is gathered as
+        //(typos, name) pairs in the order it is offered, then the names of m_added that fall in
+        //it are slotted in
+    vector<vector<pair<int, int>>> groups(4);
+    
+        //names starting with q, which sit together in the sorted names
+    for (int id = lowerBound(q); id < m_names.size() && groups[0].size() < k; id++) {
+        if (m_names.length(id) < q.size() || memcmp(m_names.data(id), q.data(), q.size()) != 0)
+            break;
+        if (!hidden(id))
+            groups[0].push_back(make_pair(0, id));
+    }
+    
+        //names with a later word starting with q
+    if (groups[0].size() < k) {
+        int first = 0, last = m_words.size();
+        for (size_t d = 0; d < q.size() && first < last; d++) {
+            int c = static_cast<unsigned char>(q[d]);
+            first = static_cast<int>(partition_point(m_words.begin() + first, m_words.begin() + last,
+                [this, d, c](const WordStart& w) { return charAt(w, d) < c; }) - m_words.begin());
+            last = static_cast<int>(partition_point(m_words.begin() + first, m_words.begin() + last,
+                [this, d, c](const WordStart& w) { return charAt(w, d) == c; }) - m_words.begin());
+        }
+        
+        vector<int> inWord;
+        for (int w = first; w < last; w++)
+            if (m_words[w].m_pos != 0)
+                inWord.push_back(m_words[w].m_name);
+        sort(inWord.begin(), inWord.end());
+        inWord.erase(unique(inWord.begin(), inWord.end()), inWord.end());
+        
+        for (size_t i = 0; i < inWord.size() && groups[1].size() < k; i++)
+            if (memcmp(m_names.data(inWord[i]), q.data(), min(q.size(), m_names.length(inWord[i]))) != 0 &&
+                !hidden(inWord[i]))                         //not offered already
+                groups[1].push_back(make_pair(0, inWord[i]));
+    }
+    
+        //names holding q inside a word; every such name holds each of q's grams, so only the
+        //names holding the rarest one are checked
+    const int32_t* first = nullptr;
+    const int32_t* last = nullptr;
+    bool allGrams = q.size() >= 3 && groups[0].size() + groups[1].size() < k;
+    for (size_t i = 0; allGrams && i + 3 <= q.size(); i++) {
+        const int32_t* f;
+        const int32_t* l;
+        if (!postings(gramAt(q.data() + i), f, l))
+            allGrams = false;
+        else if (first == nullptr || l - f < last - first) {
+            first = f;
+            last = l;
+        }
+    }
+    
+    for (const int32_t* p = first; allGrams && p != last && groups[2].size() < k; p++) {
+        
+        const char* name = m_names.data(*p);
+        size_t len = m_names.length(*p);
+        bool inside = false;
+        for (size_t pos = 0; pos + q.size() <= len; pos++)
+            if (name[pos] == q[0] && memcmp(name + pos, q.data(), q.size()) == 0) {
+                if (isWordStart(name, pos)) {
+                    inside = false;                         //offered already
+                    break;
+                }
+                inside = true;
+            }
+        if (inside && !hidden(*p))
+            groups[2].push_back(make_pair(0, *p));
+    }
+    
+        //names with a word starting almost like q: one typo allowed, two from 8 characters on
+    if (q.size() >= 4 && groups[0].size() + groups[1].size() + groups[2].size() < k) {
+        
+        FuzzyWalk fw;
+        fw.query = q;
+        fw.limit = q.size() >= 8 ? 2 : 1;
+        fw.rows.resize((q.size() + fw.limit + 1) * (q.size() + 1));
+        for (size_t i = 0; i <= q.size(); i++)
+            fw.rows[i] = static_cast<int>(i);
+        walk(fw, 0, m_words.size(), 0, fw.limit + 1);
+        
+        auto taken = [&groups](int id) {
+            for (size_t g = 0; g < groups.size(); g++)
+                for (size_t i = 0; i < groups[g].size(); i++)
+                    if (groups[g][i].second == id)
+                        return true;
+            return false;
+        };
+        
+        sort(fw.matches.begin(), fw.matches.end());
+        for (size_t i = 0; i < fw.matches.size() && groups[3].size() < k; i++)
+            if (!taken(fw.matches[i].second) && !hidden(fw.matches[i].second))
+                groups[3].push_back(fw.matches[i]);
+    }
+    
+    auto key = [this](int name) {
+        return name >= 0 ? string(m_names.data(name), m_names.length(name)) : m_added[~name].m_key;
+    };
+    for (size_t i = 0; i < m_added.size(); i++) {
+        int typos;
+        int group = matchGroup(m_added[i].m_key, q, typos);
+        if (group != -1) {
+            groups[group].push_back(make_pair(typos, ~static_cast<int>(i)));
+            stable_sort(groups[group].begin(), groups[group].end(), [&key](const pair<int, int>& a, const pair<int, int>& b) {
+                return a.first != b.first ? a.first < b.first : key(a.second) < key(b.second);
+            });
+        }
+    }
+    
+    vector<string> result;
+    for (size_t g = 0; g < groups.size(); g++)
+        for (size_t i = 0; i < groups[g].size() && result.size() < k; i++) {
+            int name = groups[g][i].second;
+            result.push_back(name >= 0 ? m_display.get(name) : m_added[~name].m_display);
+        }
+    return result;
+}
+
+void AttractionMapperImpl::save(SnapshotWriter& w) const
+{
+    w.add(SNAP_ATTINDEX_CHARS, m_names.m_chars);
+    w.add(SNAP_ATTINDEX_OFFSETS, m_names.m_offsets);
+    w.add(SNAP_ATTINDEX_COORDS, m_coords);
+    w.add(SNAP_ATTINDEX_DISPLAY_CHARS, m_display.m_chars);
+    w.add(SNAP_ATTINDEX_DISPLAY_OFFSETS, m_display.m_offsets);
+    w.add(SNAP_ATTINDEX_GRAMS, m_grams);
+    w.add(SNAP_ATTINDEX_GRAM_OFFSETS, m_gramOffsets);
+    w.add(SNAP_ATTINDEX_GRAM_NAMES, m_gramNames);
+    w.add(SNAP_ATTINDEX_WORDS, m_words);
+    w.add(SNAP_ATTINDEX_SEGMENTS, m_segments);
+}
+
+/* private member functions */
+
+int AttractionMapperImpl::lowerBound(const string& s) const
+{
+    int low = 0, high = m_names.size();                     //binary search over the sorted names
+    while (low < high) {
+        int mid = (low + high) / 2;
+        
+        const unsigned char* name = reinterpret_cast<const unsigned char*>(m_names.data(mid));
+        size_t len = m_names.length(mid);
+        size_t i = 0;
+        while (i < len && i < s.size() && name[i] == static_cast<unsigned char>(lower(s[i])))
+            i++;
+        bool less = (i < len && i < s.size()) ? name[i] < static_cast<unsigned char>(lower(s[i])) : len < s.size();
+        
+        if (less)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+bool AttractionMapperImpl::find(const string& attraction, int& base, int& added) const
+{
+    base = added = -1;
+    
+    if (!m_added.empty()) {
+        string key = attraction;
+        for (size_t i = 0; i < key.size(); i++)
+            key[i] = lower(key[i]);
+        auto at = lower_bound(m_added.begin(), m_added.end(), key,
+                              [](const AddedName& a, const string& b) { return a.m_key < b; });
+        if (at != m_added.end() && at->m_key == key) {
+            added = static_cast<int>(at - m_added.begin());
+            return true;
+        }
+    }
+    
+    int found = lowerBound(attraction);
+    if (found == m_names.size() || m_names.length(found) != attraction.size() || hidden(found))
+        return false;
+    
+    const char* name = m_names.data(found);
+    for (size_t i = 0; i < attraction.size(); i++)
+        if (name[i] != lower(attraction[i]))
+            return false;
+    
+    base = found;
+    return true;
+}
+
+int AttractionMapperImpl::charAt(const WordStart& w, size_t d) const
+{
+    size_t at = w.m_pos + d;
+    return at < m_names.length(w.m_name) ? static_cast<unsigned char>(m_names.data(w.m_name)[at]) : -1;
+}
+
+void AttractionMapperImpl::walk(FuzzyWalk& fw, int first, int last, size_t depth, int found) const
+{
+        //row j holds the distances between the first j characters of the words and each prefix
+        //of the query; a word's distance is the last entry of the best row along it, and once a
+        //whole row exceeds the limit no longer word can come back within it
+    const string& q = fw.query;
+    size_t m = q.size();
+    if (depth >= m + fw.limit)
+        return;
+    
+    int at = first;
+    while (at < last && charAt(m_words[at], depth) == -1)  //words ending here were counted above
+        at++;
+    
+    while (at < last) {
+        int c = charAt(m_words[at], depth);
+        int end = static_cast<int>(partition_point(m_words.begin() + at, m_words.begin() + last,
+            [this, depth, c](const WordStart& w) { return charAt(w, depth) == c; }) - m_words.begin());
+        
+            //words are taken to start with the query's first letter, or its first two swapped;
+            //otherwise every word would be within the limit for its first few letters
+        if (depth == 0 && c != static_cast<unsigned char>(q[0]) && c != static_cast<unsigned char>(q[1])) {
+            at = end;
+            continue;
+        }
+        
+        const int* prev = &fw.rows[depth * (m + 1)];
+        int* curr = &fw.rows[(depth + 1) * (m + 1)];
+        int before = depth > 0 ? charAt(m_words[at], depth - 1) : -1;
+        curr[0] = static_cast<int>(depth + 1);
+        int least = curr[0];
+        for (size_t i = 1; i <= m; i++) {
+            int here = static_cast<unsigned char>(q[i-1]);
+            int d = min(min(prev[i] + 1, curr[i-1] + 1), prev[i-1] + (here == c ? 0 : 1));
+            if (i > 1 && depth > 0 && here == before && static_cast<unsigned char>(q[i-2]) == c)
+                d = min(d, fw.rows[(depth - 1) * (m + 1) + i - 2] + 1);
+            curr[i] = d;
+            least = min(least, d);
+        }
+        
+        int best = found;
+        if (curr[m] < found) {
+            best = curr[m];
+            for (int w = at; w < end; w++)
+                fw.matches.push_back(make_pair(best, static_cast<int>(m_words[w].m_name)));
+        }
+        if (least <= fw.limit && best > 0)
+            walk(fw, at, end, depth + 1, best);
+        at = end;
+    }
+}
+
+bool AttractionMapperImpl::postings(uint32_t gram, const int32_t*& first, const int32_t*& last) const
+{
+    const uint32_t* it = lower_bound(m_grams.begin(), m_grams.end(), gram);
+    if (it == m_grams.end() || *it != gram)
+        return false;
+    
+    size_t g = it - m_grams.begin();
+    first = m_gramNames.data() + m_gramOffsets[g];
+    last = m_gramNames.data() + m_gramOffsets[g+1];
+    return true;
+}
+
 //******************** AttractionMapper functions *****************************
 
 // These functions simply delegate to AttractionMapperImpl's functions.
@@ -74,7 +630,37 @@ void AttractionMapper::init(const MapLoader& ml)
 	m_impl->init(ml);
 }
 
-bool AttractionMapper::getGeoCoord(string attraction, GeoCoord& gc) const
+bool AttractionMapper::getGeoCoord(const string& attraction, GeoCoord& gc) const
 {
 	return m_impl->getGeoCoord(attraction, gc);
 }
+
+bool AttractionMapper::getGeoCoord(const string& attraction, FixedCoord& fc) const
+{
+	return m_impl->getGeoCoord(attraction, fc);
+}
+
+vector<string> AttractionMapper::complete(const string& text, size_t k) const
+{
+	return m_impl->complete(text, k);
+}
+
+int AttractionMapper::getSegmentId(const string& attraction) const
+{
+	return m_impl->getSegmentId(attraction);
+}
+
+void AttractionMapper::addAttraction(const string& name, const FixedCoord& fc, int segment)
+{
+	m_impl->addAttraction(name, fc, segment);
+}
+
+bool AttractionMapper::removeAttraction(const string& name)
+{
+	return m_impl->removeAttraction(name);
+}
+
+void AttractionMapper::save(SnapshotWriter& w) const
+{
+	m_impl->save(w);
+}
@@ -0,0 +1,685 @@
+#include "ContractionHierarchy.h"
+#include "RoadGraph.h"
+#include "SearchWorkspace.h"
+#include "TilePrefetcher.h"
+#include "MapSnapshot.h"
+#include "provided.h"
+#include "support.h"
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <functional>
+using namespace std;
+
+namespace {
+
+        //a witness search gives up after settling this many nodes; estimating a node's
+        //priority can afford to miss more witnesses than actually contracting it
+    const int witnessSettleLimit = 500;
+    const int simulatedSettleLimit = 50;
+
+    struct arc {                            //edge of the graph while it is being contracted
+        int m_to;
+        double m_weight;
+        int m_middle;                       //-1 for a road edge
+        int m_edge;                         //RoadGraph edge of a road edge, -1 for a shortcut
+    };
+
+        //adds the edge from-to, or shortens the existing one
+    void addArc(vector<vector<arc>>& adj, int from, int to, double weight, int middle, int edge) {
+
+        for (size_t i = 0; i < adj[from].size(); i++) {
+            arc& a = adj[from][i];
+            if (a.m_to == to) {
+                if (weight < a.m_weight) {
+                    a.m_weight = weight;
+                    a.m_middle = middle;
+                    a.m_edge = edge;
+                }
+                return;
+            }
+        }
+
+        arc a = { to, weight, middle, edge };
+        adj[from].push_back(a);
+    }
+
+        //Dijkstra from source over the nodes not yet contracted, never entering skip,
+        //until it has gone further than limit or settled maxSettled nodes
+    void witnessSearch(const vector<vector<arc>>& adj, int source, int skip, double limit, int maxSettled,
+                       SearchWorkspace& ws) {
+
+        ws.reset(static_cast<int>(adj.size()));
+        ws.reach(source, 0, -1);
+        ws.push(0, source);
+
+        int settled = 0;
+        while (!ws.heapEmpty() && ws.heapMin() <= limit && settled < maxSettled) {
+
+            int curr = ws.pop().second;
+            if (ws.settled(curr))
+                continue;
+            ws.settle(curr);
+            settled++;
+
+            for (size_t i = 0; i < adj[curr].size(); i++) {
+
+                const arc& a = adj[curr][i];
+                if (a.m_to == skip || ws.settled(a.m_to))
+                    continue;
+
+                double newDist = ws.dist(curr) + a.m_weight;
+                if (!ws.reached(a.m_to) || ws.dist(a.m_to) > newDist) {
+                    ws.reach(a.m_to, newDist, curr);
+                    ws.push(newDist, a.m_to);
+                }
+            }
+        }
+    }
+
+        //adds the shortcuts node's neighbours need to do without it (or, if simulate is true,
+        //only counts them); returns the change in the number of edges its removal makes
+    int contract(vector<vector<arc>>& adj, int node, bool simulate, SearchWorkspace& ws) {
+
+        const vector<arc>& neighbours = adj[node];  //shortcuts only join neighbours, so this list stays put
+
+        int shortcuts = 0;
+        for (size_t i = 0; i + 1 < neighbours.size(); i++) {
+
+            double limit = 0;
+            for (size_t j = i + 1; j < neighbours.size(); j++)
+                limit = max(limit, neighbours[i].m_weight + neighbours[j].m_weight);
+
+            witnessSearch(adj, neighbours[i].m_to, node, limit, simulate ? simulatedSettleLimit : witnessSettleLimit, ws);
+
+            for (size_t j = i + 1; j < neighbours.size(); j++) {
+
+                int u = neighbours[i].m_to;
+                int w = neighbours[j].m_to;
+                double via = neighbours[i].m_weight + neighbours[j].m_weight;
+
+                if (ws.reached(w) && ws.dist(w) <= via)     //a path at least as short avoids node
+                    continue;
+
+                shortcuts++;
+                if (!simulate) {
+                    addArc(adj, u, w, via, node, -1);
+                    addArc(adj, w, u, via, node, -1);
+                }
+            }
+        }
+
+        return shortcuts - static_cast<int>(neighbours.size());
+    }
+
+    struct candidate {                      //edge that addEdge is to put into the hierarchy
+        int m_a;
+        int m_b;
+        double m_weight;
+        int m_middle;                       //-1 for a road edge
+    };
+}
+
+ContractionHierarchy::ContractionHierarchy() : m_numNodes(0), m_first(nullptr), m_last(nullptr), m_lowestRank(0)
+{
+}
+
+ContractionHierarchy::~ContractionHierarchy()
+{
+}
+
+void ContractionHierarchy::clear()
+{
+    m_offsets.clear();
+    m_targets.clear();
+    m_weights.clear();
+    m_middles.clear();
+    m_edges.clear();
+    m_begins.clear();
+    m_ends.clear();
+    m_limits.clear();
+    m_ranks.clear();
+    useOffsets();
+}
+
+void ContractionHierarchy::build(const RoadGraph& graph)
+{
+    clear();
+
+    int n = graph.numNodes();
+    vector<vector<arc>> adj(n);
+    for (int v = 0; v < n; v++)
+        for (int e = graph.edgeBegin(v); e < graph.edgeEnd(v); e++)
+            addArc(adj, v, graph.target(e), graph.weight(e), -1, e);    //parallel edges keep the shortest
+
+    vector<bool> contracted(n, false);
+    vector<int> deletedNeighbours(n, 0);
+    vector<int> priority(n);
+    SearchWorkspace ws;
+
+        //least important first: nodes whose removal adds the fewest edges, spread out
+        //over the map by also counting neighbours that have already gone
+    typedef pair<int, int> entry;
+    priority_queue<entry, vector<entry>, greater<entry>> order;
+    for (int v = 0; v < n; v++) {
+        priority[v] = contract(adj, v, true, ws);
+        order.push(make_pair(priority[v], v));
+    }
+
+    vector<vector<arc>> upward(n);
+
+    while (!order.empty()) {
+
+        entry top = order.top();
+        order.pop();
+
+        int v = top.second;
+        if (contracted[v] || top.first != priority[v])          //stale entry
+            continue;
+
+            //priorities go stale as the graph changes; recompute lazily and requeue if it rose
+        priority[v] = contract(adj, v, true, ws) + deletedNeighbours[v];
+        if (!order.empty() && priority[v] > order.top().first) {
+            order.push(make_pair(priority[v], v));
+            continue;
+        }
+
+        contract(adj, v, false, ws);
+        contracted[v] = true;
+
+            //v's remaining edges all lead to nodes contracted after it, and no longer change;
+            //they become its upward edges, and v leaves its neighbours' lists
+        upward[v].swap(adj[v]);
+        for (size_t i = 0; i < upward[v].size(); i++) {
+            int u = upward[v][i].m_to;
+            for (size_t j = 0; j < adj[u].size(); j++) {
+                if (adj[u][j].m_to == v) {
+                    adj[u][j] = adj[u].back();
+                    adj[u].pop_back();
+                    break;
+                }
+            }
+            deletedNeighbours[u]++;
+            priority[u] = contract(adj, u, true, ws) + deletedNeighbours[u];
+            order.push(make_pair(priority[u], u));
+        }
+    }
+
+    vector<int32_t> offsets(n + 1, 0);
+    vector<int32_t> targets;
+    vector<double> weights;
+    vector<int32_t> middles;
+    vector<int32_t> edges;
+
+    for (int v = 0; v < n; v++) {
+        for (size_t i = 0; i < upward[v].size(); i++) {
+            targets.push_back(upward[v][i].m_to);
+            weights.push_back(upward[v][i].m_weight);
+            middles.push_back(upward[v][i].m_middle);
+            edges.push_back(upward[v][i].m_edge);
+        }
+        offsets[v + 1] = static_cast<int32_t>(targets.size());
+    }
+
+    m_offsets.adopt(offsets);
+    m_targets.adopt(targets);
+    m_weights.adopt(weights);
+    m_middles.adopt(middles);
+    m_edges.adopt(edges);
+    useOffsets();
+}
+
+bool ContractionHierarchy::load(const MapLoader& ml)
+{
+    clear();
+
+    const MapSnapshot* snap = ml.getSnapshot();
+    if (snap != nullptr && snap->get(SNAP_CH_OFFSETS, m_offsets) && snap->get(SNAP_CH_TARGETS, m_targets) &&
+        snap->get(SNAP_CH_WEIGHTS, m_weights) && snap->get(SNAP_CH_MIDDLES, m_middles) &&
+        snap->get(SNAP_CH_EDGES, m_edges)) {
+        useOffsets();
+        return true;
+    }
+
+    clear();
+    return false;
+}
+
+void ContractionHierarchy::save(SnapshotWriter& w) const
+{
+    if (m_last != m_ends.data() || m_last == nullptr) {
+        w.add(SNAP_CH_OFFSETS, m_offsets);
+        w.add(SNAP_CH_TARGETS, m_targets);
+        w.add(SNAP_CH_WEIGHTS, m_weights);
+        w.add(SNAP_CH_MIDDLES, m_middles);
+        w.add(SNAP_CH_EDGES, m_edges);
+        return;
+    }
+
+        //edited: the runs are packed back together, in node order
+    vector<int32_t> offsets(1, 0);
+    vector<int32_t> targets;
+    vector<double> weights;
+    vector<int32_t> middles;
+    vector<int32_t> edges;
+    for (int v = 0; v < m_numNodes; v++) {
+        for (int e = m_first[v]; e < m_last[v]; e++) {
+            targets.push_back(m_targets[e]);
+            weights.push_back(m_weights[e]);
+            middles.push_back(m_middles[e]);
+            edges.push_back(m_edges[e]);
+        }
+        offsets.push_back(static_cast<int32_t>(targets.size()));
+    }
+
+    w.addRaw(SNAP_CH_OFFSETS, sizeof(int32_t), offsets.data(), offsets.size());
+    w.addRaw(SNAP_CH_TARGETS, sizeof(int32_t), targets.data(), targets.size());
+    w.addRaw(SNAP_CH_WEIGHTS, sizeof(double), weights.data(), weights.size());
+    w.addRaw(SNAP_CH_MIDDLES, sizeof(int32_t), middles.data(), middles.size());
+    w.addRaw(SNAP_CH_EDGES, sizeof(int32_t), edges.data(), edges.size());
+}
+
+void ContractionHierarchy::addTo(TilePrefetcher& prefetcher) const
+{
+    prefetcher.addNodeArray(m_offsets);
+    prefetcher.addEdgeArray(m_targets, m_offsets);
+    prefetcher.addEdgeArray(m_weights, m_offsets);
+    prefetcher.addEdgeArray(m_middles, m_offsets);
+    prefetcher.addEdgeArray(m_edges, m_offsets);
+}
+
+int ContractionHierarchy::views() const
+{
+    return m_offsets.isView() + m_targets.isView() + m_weights.isView() + m_middles.isView() + m_edges.isView();
+}
+
+int ContractionHierarchy::numShortcuts() const
+{
+    int count = 0;
+    for (int v = 0; v < m_numNodes; v++)
+        for (int e = m_first[v]; e < m_last[v]; e++)
+            if (m_middles[e] != -1)
+                count++;
+    return count;
+}
+
+void ContractionHierarchy::addEdge(const RoadGraph& graph, int a, int b, double weight, SearchWorkspace& fw, SearchWorkspace& bw)
+{
+    prepareEdits(graph.numNodes());
+
+    vector<candidate> todo(1, candidate{ a, b, weight, -1 });
+    while (!todo.empty()) {
+
+        candidate c = todo.back();
+        todo.pop_back();
+
+        int u = m_ranks[c.m_a] < m_ranks[c.m_b] ? c.m_a : c.m_b;     //the edge is stored at its lower end
+        int v = u == c.m_a ? c.m_b : c.m_a;
+
+        int e = findEdge(u, v);
+        if (e != -1 && m_weights[e] <= c.m_weight)
+            continue;
+        if (witnessed(u, v, c.m_weight, fw, bw))        //routes already do as well without it
+            continue;
+
+        int roadEdge = -1;
+        if (c.m_middle == -1)
+            for (int g = graph.edgeBegin(u); g < graph.edgeEnd(u) && roadEdge == -1; g++)
+                if (graph.target(g) == v && graph.weight(g) == c.m_weight)
+                    roadEdge = g;
+
+        if (e == -1)
+            appendEdge(u, v, c.m_weight, c.m_middle, roadEdge);
+        else {
+            m_weights.edit(e) = c.m_weight;
+            m_middles.edit(e) = c.m_middle;
+            m_edges.edit(e) = roadEdge;
+        }
+
+            //a route may now come up to u from any of its upper neighbours and go on over
+            //u-v, which has to be a shortcut between the neighbour and v
+        for (int f = m_first[u]; f < m_last[u]; f++)
+            if (m_targets[f] != v)
+                todo.push_back(candidate{ m_targets[f], v, m_weights[f] + c.m_weight, u });
+    }
+}
+
+bool ContractionHierarchy::findPath(const RouteEnd& source, const RouteEnd& target, vector<int>& path, vector<int>& edges,
+                                    SearchWorkspace& fw, SearchWorkspace& bw) const
+{
+    if (source.numNodes == 1 && target.numNodes == 1 && source.nodes[0] == target.nodes[0]) {
+        path.assign(1, source.nodes[0]);
+        edges.clear();
+        return true;
+    }
+
+    int n = m_numNodes;
+    fw.reset(n);
+    bw.reset(n);
+
+        //each search starts from all of its end's nodes; where the two share a node, the
+        //searches meet there as soon as either settles it
+    const RouteEnd* ends[2] = { &source, &target };
+    SearchWorkspace* sides[2] = { &fw, &bw };
+    for (int s = 0; s < 2; s++) {
+        for (int k = 0; k < ends[s]->numNodes; k++) {
+            int node = ends[s]->nodes[k];
+            double dist = ends[s]->dists[k];
+            if (!sides[s]->reached(node) || sides[s]->dist(node) > dist) {
+                sides[s]->reach(node, dist, -1);
+                sides[s]->push(dist, node);
+            }
+        }
+    }
+
+    double best = -1;                       //length of the best path found, -1 if none
+    int meeting = -1;                       //highest node on that path
+    bool forward = true;
+
+        //the two searches take turns until neither can improve on best
+    for (;;) {
+
+        bool fwDone = fw.heapEmpty() || (best >= 0 && fw.heapMin() >= best);
+        bool bwDone = bw.heapEmpty() || (best >= 0 && bw.heapMin() >= best);
+        if (fwDone && bwDone)
+            break;
+        if (fwDone || bwDone)
+            forward = bwDone;
+
+        SearchWorkspace& ws = forward ? fw : bw;
+        SearchWorkspace& other = forward ? bw : fw;
+        forward = !forward;
+
+        int curr = ws.pop().second;
+        if (ws.settled(curr)) {
+            ws.noteStalePop();
+            continue;
+        }
+        ws.settle(curr);
+
+        if (other.reached(curr) && (best < 0 || ws.dist(curr) + other.dist(curr) < best)) {
+            best = ws.dist(curr) + other.dist(curr);
+            meeting = curr;
+        }
+
+            //stall on demand: if a higher node already reaches curr more cheaply, curr is not
+            //on a shortest path from this side and its edges need not be followed
+        bool stalled = false;
+        for (int e = m_first[curr]; e < m_last[curr] && !stalled; e++) {
+            int up = m_targets[e];
+            if (ws.reached(up) && ws.dist(up) + m_weights[e] < ws.dist(curr))
+                stalled = true;
+        }
+        if (stalled)
+            continue;
+
+        ws.noteRelaxed(m_last[curr] - m_first[curr]);
+        for (int e = m_first[curr]; e < m_last[curr]; e++) {
+
+            int next = m_targets[e];
+            double newDist = ws.dist(curr) + m_weights[e];
+
+            if (!ws.reached(next) || ws.dist(next) > newDist) {
+                ws.reach(next, newDist, curr, e);
+                ws.push(newDist, next);
+            }
+        }
+    }
+
+    fw.noteSearchDone();
+    if (meeting == -1)
+        return false;
+
+        //hierarchy nodes from source up to meeting and down to target, and the
+        //hierarchy edges between them
+    vector<int>& climb = bw.m_path;
+    vector<int>& climbEdges = bw.m_pathEdges;
+    climb.clear();
+    climbEdges.clear();
+    for (int node = meeting; node != -1; node = fw.parent(node)) {
+        climb.push_back(node);
+        if (fw.parent(node) != -1)
+            climbEdges.push_back(fw.parentEdge(node));
+    }
+    reverse(climb.begin(), climb.end());
+    reverse(climbEdges.begin(), climbEdges.end());
+    for (int node = meeting; bw.parent(node) != -1; node = bw.parent(node)) {
+        climb.push_back(bw.parent(node));
+        climbEdges.push_back(bw.parentEdge(node));
+    }
+
+    path.assign(1, climb[0]);                   //whichever of source's nodes the route leaves by
+    edges.clear();
+    for (size_t i = 0; i + 1 < climb.size(); i++)
+        unpack(climbEdges[i], climb[i], climb[i+1], path, edges);
+    reverse(path.begin(), path.end());          //target first, like NavigatorImpl::pathFinder
+    reverse(edges.begin(), edges.end());
+
+    return true;
+}
+
+void ContractionHierarchy::buildBuckets(const vector<int>& targets, TargetBuckets& buckets, SearchWorkspace& ws) const
+{
+    int n = m_numNodes;
+    vector<pair<int, int>> entries;             //(node, target index), collected in target order
+    vector<double> dists;
+
+    for (size_t j = 0; j < targets.size(); j++) {
+        upwardSearch(targets[j], ws);
+        for (size_t i = 0; i < ws.m_path.size(); i++) {
+            entries.push_back(make_pair(ws.m_path[i], static_cast<int>(j)));
+            dists.push_back(ws.dist(ws.m_path[i]));
+        }
+    }
+
+        //counting sort of the entries by node
+    buckets.m_offsets.assign(n + 1, 0);
+    for (size_t i = 0; i < entries.size(); i++)
+        buckets.m_offsets[entries[i].first + 1]++;
+    for (int v = 0; v < n; v++)
+        buckets.m_offsets[v + 1] += buckets.m_offsets[v];
+
+    buckets.m_targets.resize(entries.size());
+    buckets.m_dists.resize(entries.size());
+    vector<int32_t> next(buckets.m_offsets.begin(), buckets.m_offsets.end() - 1);
+    for (size_t i = 0; i < entries.size(); i++) {
+        int slot = next[entries[i].first]++;
+        buckets.m_targets[slot] = entries[i].second;
+        buckets.m_dists[slot] = dists[i];
+    }
+}
+
+void ContractionHierarchy::scanBuckets(int source, const TargetBuckets& buckets, double row[], SearchWorkspace& ws) const
+{
+    upwardSearch(source, ws);
+
+    for (size_t i = 0; i < ws.m_path.size(); i++) {
+
+        int node = ws.m_path[i];
+        for (int b = buckets.m_offsets[node]; b < buckets.m_offsets[node+1]; b++) {
+
+            double d = ws.dist(node) + buckets.m_dists[b];
+            double& best = row[buckets.m_targets[b]];
+            if (best < 0 || d < best)
+                best = d;
+        }
+    }
+}
+
+/* private member functions */
+
+void ContractionHierarchy::upwardSearch(int from, SearchWorkspace& ws) const
+{
+    ws.reset(m_numNodes);
+    ws.reach(from, 0, -1);
+    ws.push(0, from);
+    ws.m_path.clear();
+
+    while (!ws.heapEmpty()) {
+
+        int curr = ws.pop().second;
+        if (ws.settled(curr))
+            continue;
+        ws.settle(curr);
+
+        bool stalled = false;                   //as in findPath
+        for (int e = m_first[curr]; e < m_last[curr] && !stalled; e++) {
+            int up = m_targets[e];
+            if (ws.reached(up) && ws.dist(up) + m_weights[e] < ws.dist(curr))
+                stalled = true;
+        }
+        if (stalled)
+            continue;
+
+        ws.m_path.push_back(curr);
+
+        for (int e = m_first[curr]; e < m_last[curr]; e++) {
+
+            int next = m_targets[e];
+            double newDist = ws.dist(curr) + m_weights[e];
+
+            if (!ws.reached(next) || ws.dist(next) > newDist) {
+                ws.reach(next, newDist, curr);
+                ws.push(newDist, next);
+            }
+        }
+    }
+}
+
+void ContractionHierarchy::unpack(int edge, int a, int b, vector<int>& path, vector<int>& edges) const
+{
+    int middle = m_middles[edge];
+    if (middle == -1) {
+        path.push_back(b);
+        edges.push_back(m_edges[edge]);
+        return;
+    }
+
+    unpack(findEdge(a, middle), a, middle, path, edges);
+    unpack(findEdge(middle, b), middle, b, path, edges);
+}
+
+int ContractionHierarchy::findEdge(int a, int b) const
+{
+    for (int e = m_first[a]; e < m_last[a]; e++)
+        if (m_targets[e] == b)
+            return e;
+
+    for (int e = m_first[b]; e < m_last[b]; e++)
+        if (m_targets[e] == a)
+            return e;
+
+    return -1;
+}
+
+void ContractionHierarchy::useOffsets()
+{
+    m_first = m_offsets.data();
+    m_last = m_offsets.empty() ? nullptr : m_offsets.data() + 1;
+    m_numNodes = m_offsets.empty() ? 0 : static_cast<int>(m_offsets.size()) - 1;
+}
+
+void ContractionHierarchy::prepareEdits(int numNodes)
+{
+    if (m_last != m_ends.data() || m_last == nullptr) {
+
+        m_begins.assign(m_offsets.begin(), m_offsets.end() - 1);
+        m_ends.assign(m_offsets.begin() + 1, m_offsets.end());
+        m_limits = m_ends;
+
+            //ranks by Kahn's algorithm: a node comes after every node with an upward edge to it
+        vector<int> below(m_numNodes, 0);
+        for (size_t e = 0; e < m_targets.size(); e++)
+            below[m_targets[e]]++;
+        vector<int> ready;
+        for (int v = 0; v < m_numNodes; v++)
+            if (below[v] == 0)
+                ready.push_back(v);
+
+        m_ranks.assign(m_numNodes, 0);
+        int32_t rank = 0;
+        while (!ready.empty()) {
+            int v = ready.back();
+            ready.pop_back();
+            m_ranks[v] = rank++;
+            for (int e = m_offsets[v]; e < m_offsets[v+1]; e++)
+                if (--below[m_targets[e]] == 0)
+                    ready.push_back(m_targets[e]);
+        }
+        m_lowestRank = 0;
+    }
+
+    int32_t end = static_cast<int32_t>(m_targets.size());
+    for (int v = m_numNodes; v < numNodes; v++) {       //nodes added to the graph join at the bottom
+        m_begins.push_back(end);
+        m_ends.push_back(end);
+        m_limits.push_back(end);
+        m_ranks.push_back(--m_lowestRank);
+    }
+    m_numNodes = max(m_numNodes, numNodes);
+    m_first = m_begins.data();
+    m_last = m_ends.data();
+}
+
+void ContractionHierarchy::appendEdge(int from, int to, double weight, int middle, int edge)
+{
+    if (m_ends[from] == m_limits[from]) {           //no free slot: move the run to the end, doubled, as RoadGraph does
+        int32_t begin = m_begins[from];
+        int32_t count = m_ends[from] - begin;
+        int32_t moved = static_cast<int32_t>(m_targets.size());
+        for (int32_t i = 0; i < max(count, 2) * 2; i++) {
+            bool used = i < count;
+            m_targets.push_back(used ? m_targets[begin + i] : from);
+            m_weights.push_back(used ? m_weights[begin + i] : 0);
+            m_middles.push_back(used ? m_middles[begin + i] : -1);
+            m_edges.push_back(used ? m_edges[begin + i] : -1);
+        }
+        m_begins[from] = moved;
+        m_ends[from] = moved + count;
+        m_limits[from] = static_cast<int32_t>(m_targets.size());
+    }
+
+    int e = m_ends[from]++;
+    m_targets.edit(e) = to;
+    m_weights.edit(e) = weight;
+    m_middles.edit(e) = middle;
+    m_edges.edit(e) = edge;
+}
+
+bool ContractionHierarchy::witnessed(int a, int b, double limit, SearchWorkspace& fw, SearchWorkspace& bw) const
+{
+    SearchWorkspace* sides[2] = { &fw, &bw };
+    int from[2] = { a, b };
+
+    for (int s = 0; s < 2; s++) {
+
+        SearchWorkspace& ws = *sides[s];
+        ws.reset(m_numNodes);
+        ws.reach(from[s], 0, -1);
+        ws.push(0, from[s]);
+
+        int settled = 0;
+        while (!ws.heapEmpty() && ws.heapMin() <= limit && settled < witnessSettleLimit) {
+
+            int curr = ws.pop().second;
+            if (ws.settled(curr))
+                continue;
+            ws.settle(curr);
+            settled++;
+
+            if (s == 1 && fw.reached(curr) && fw.dist(curr) + ws.dist(curr) <= limit)
+                return true;
+
+            for (int e = m_first[curr]; e < m_last[curr]; e++) {
+                int next = m_targets[e];
+                double newDist = ws.dist(curr) + m_weights[e];
+                if (newDist <= limit && (!ws.reached(next) || ws.dist(next) > newDist)) {
+                    ws.reach(next, newDist, curr);
+                    ws.push(newDist, next);
+                }
+            }
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,124 @@
+// ContractionHierarchy.h
+
+#ifndef CONTRACTIONHIERARCHY_INCLUDED
+#define CONTRACTIONHIERARCHY_INCLUDED
+
+#include "provided.h"
+#include "support.h"
+#include <vector>
+
+class RoadGraph;
+class SearchWorkspace;
+class TilePrefetcher;
+
+// A contraction hierarchy over a RoadGraph. Preprocessing removes the nodes
+// one at a time, least important first, and adds a shortcut between two of a
+// removed node's neighbours whenever the only shortest path between them ran
+// through it. Each node keeps just its edges to nodes removed after it (its
+// "upward" edges), in CSR form like RoadGraph, so a query is two small
+// Dijkstra searches that only ever climb the hierarchy and meet at the top.
+//
+// A shortcut remembers the node it bypasses (its middle), which is how a
+// route found over shortcuts is unpacked back into RoadGraph nodes, and a
+// road edge remembers its RoadGraph edge. The arrays are flat so that the
+// hierarchy can be stored in a map snapshot.
+//
+// Edges added to the graph can be added to the hierarchy in place. The new
+// edge goes to whichever end is lower in a fixed order of the nodes that the
+// upward edges respect (a node new to the hierarchy comes below all others),
+// and since a route may now come down to that end and climb the new edge,
+// each of the end's upward neighbours is joined to the other end by a
+// shortcut, unless the hierarchy already joins them at least as cheaply;
+// the shortcuts are added the same way in turn. Weights only ever go down,
+// so nothing the hierarchy had is lost, and like RoadGraph the first edit
+// gives every node a separate begin and end into the edge arrays.
+
+class ContractionHierarchy
+{
+public:
+    ContractionHierarchy();
+    ~ContractionHierarchy();
+
+        //contracts graph; takes a few hundred milliseconds for the LA map
+    void build(const RoadGraph& graph);
+        //uses the hierarchy compiled into ml's snapshot; false if there is none
+    bool load(const MapLoader& ml);
+    void clear();
+    void save(SnapshotWriter& w) const;
+    bool empty() const { return m_offsets.empty(); }
+
+        //gives the hierarchy nodes up to numNodes, without edges, at the bottom
+    void addNodes(int numNodes) { if (numNodes > m_numNodes) prepareEdits(numNodes); }
+        //puts graph's edge of weight between a and b into the hierarchy, with the shortcuts
+        //routes over it need; nodes the hierarchy has not got yet join it. fw and bw are used
+        //for the searches that check whether an edge is needed
+    void addEdge(const RoadGraph& graph, int a, int b, double weight, SearchWorkspace& fw, SearchWorkspace& bw);
+
+        //returns true if source and target are connected, and sets path to the RoadGraph
+        //nodes of a shortest route, from one of target's nodes back to one of source's,
+        //and edges[i] to the RoadGraph edge joining path[i] and path[i+1]. fw and bw hold
+        //the two searches
+    bool findPath(const RouteEnd& source, const RouteEnd& target, std::vector<int>& path, std::vector<int>& edges,
+                  SearchWorkspace& fw, SearchWorkspace& bw) const;
+
+        //Many-to-many distances with buckets: every node settled by a target's upward
+        //search gets an entry in its bucket (the target and the distance), and then a
+        //source's upward search meets all the targets at once by scanning the buckets
+        //of the nodes it settles.
+    struct TargetBuckets {
+        std::vector<int32_t> m_offsets;     // bucket of node n is [m_offsets[n], m_offsets[n+1])
+        std::vector<int32_t> m_targets;     // index into the list of targets
+        std::vector<double> m_dists;
+    };
+    void buildBuckets(const std::vector<int>& targets, TargetBuckets& buckets, SearchWorkspace& ws) const;
+        //sets row[j] to the distance from source to targets[j], or -1 if it is unreachable
+    void scanBuckets(int source, const TargetBuckets& buckets, double row[], SearchWorkspace& ws) const;
+
+    int numShortcuts() const;
+        //hands prefetcher the arrays, which are indexed like RoadGraph's nodes
+    void addTo(TilePrefetcher& prefetcher) const;
+        //how many of the arrays addTo hands over are views into a snapshot
+    int views() const;
+
+      // We prevent a ContractionHierarchy object from being copied or assigned.
+    ContractionHierarchy(const ContractionHierarchy&) = delete;
+    ContractionHierarchy& operator=(const ContractionHierarchy&) = delete;
+
+private:
+    FlatArray<int32_t> m_offsets;           // upward edges of node n are [m_offsets[n], m_offsets[n+1])
+    FlatArray<int32_t> m_targets;
+    FlatArray<double> m_weights;
+    FlatArray<int32_t> m_middles;           // bypassed node of a shortcut, -1 for a road edge
+    FlatArray<int32_t> m_edges;             // RoadGraph edge of a road edge, -1 for a shortcut
+    int m_numNodes;
+
+        //the upward edges of node are [m_first[node], m_last[node]): m_offsets and m_offsets+1
+        //as built, or m_begins and m_ends once an edge has been added
+    const int32_t* m_first;
+    const int32_t* m_last;
+    std::vector<int32_t> m_begins;
+    std::vector<int32_t> m_ends;
+    std::vector<int32_t> m_limits;          // end of the slots node's run may grow into
+    std::vector<int32_t> m_ranks;           // lower nodes first, consistent with the upward edges; made for the first edit
+    int32_t m_lowestRank;                   // given to the last node added
+
+    /* private member functions */
+    void useOffsets();
+    void prepareEdits(int numNodes);        //also adds nodes up to numNodes
+        //the upward edge from-to, put in a free slot or at the end of the arrays
+    void appendEdge(int from, int to, double weight, int middle, int edge);
+        //whether the hierarchy has a route of at most limit between a and b, going by what
+        //two upward searches of witnessSettleLimit nodes find
+    bool witnessed(int a, int b, double limit, SearchWorkspace& fw, SearchWorkspace& bw) const;
+
+        //the whole upward search space of from, with stalling; ws.m_path lists the nodes
+        //whose distances are exact enough to use
+    void upwardSearch(int from, SearchWorkspace& ws) const;
+        //appends the RoadGraph nodes strictly after a up to and including b, and the RoadGraph
+        //edges between them, walking the hierarchy edge a-b
+    void unpack(int edge, int a, int b, std::vector<int>& path, std::vector<int>& edges) const;
+        //index of the upward edge joining a and b, stored at whichever is lower in the hierarchy
+    int findEdge(int a, int b) const;
+};
+
+#endif // CONTRACTIONHIERARCHY_INCLUDED
@@ -0,0 +1,189 @@
+#include "Landmarks.h"
+#include "RoadGraph.h"
+#include "SearchWorkspace.h"
+#include "TilePrefetcher.h"
+#include "MapSnapshot.h"
+#include "provided.h"
+#include "support.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+using namespace std;
+
+namespace {
+
+        //Dijkstra from all of sources at once; returns the last node settled, the one
+        //farthest from all of them, and leaves the distances in ws
+    int dijkstra(const RoadGraph& graph, const vector<int>& sources, SearchWorkspace& ws) {
+
+        ws.reset(graph.numNodes());
+        for (size_t i = 0; i < sources.size(); i++) {
+            ws.reach(sources[i], 0, -1);
+            ws.push(0, sources[i]);
+        }
+
+        int last = sources.empty() ? -1 : sources[0];
+        while (!ws.heapEmpty()) {
+
+            int curr = ws.pop().second;
+            if (ws.settled(curr))
+                continue;
+            ws.settle(curr);
+            last = curr;
+
+            for (int e = graph.edgeBegin(curr); e < graph.edgeEnd(curr); e++) {
+
+                int next = graph.target(e);
+                double newDist = ws.dist(curr) + graph.weight(e);
+                if (!ws.reached(next) || ws.dist(next) > newDist) {
+                    ws.reach(next, newDist, curr);
+                    ws.push(newDist, next);
+                }
+            }
+        }
+        return last;
+    }
+}
+
+Landmarks::Landmarks()
+{
+}
+
+Landmarks::~Landmarks()
+{
+}
+
+void Landmarks::clear()
+{
+    m_nodes.clear();
+    m_dist.clear();
+}
+
+void Landmarks::build(const RoadGraph& graph, int count)
+{
+    clear();
+
+    int n = graph.numNodes();
+    if (n == 0 || count <= 0)
+        return;
+
+    SearchWorkspace ws;
+    vector<int> nodes;
+
+        //farthest-point selection: start from the node farthest from node 0, then keep
+        //adding the node farthest from every landmark chosen so far
+    vector<int> seed(1, 0);
+    nodes.push_back(dijkstra(graph, seed, ws));
+    while (static_cast<int>(nodes.size()) < count && static_cast<int>(nodes.size()) < n) {
+        int next = dijkstra(graph, nodes, ws);
+        if (find(nodes.begin(), nodes.end(), next) != nodes.end())
+            break;                          //every reachable node is a landmark already
+        nodes.push_back(next);
+    }
+
+    int k = static_cast<int>(nodes.size());
+    vector<double> dist(static_cast<size_t>(n) * k);
+    for (int i = 0; i < k; i++) {
+        vector<int> source(1, nodes[i]);
+        dijkstra(graph, source, ws);
+        for (int v = 0; v < n; v++)
+            dist[static_cast<size_t>(v) * k + i] = ws.reached(v) ? ws.dist(v) : -1;
+    }
+
+    vector<int32_t> ids(nodes.begin(), nodes.end());
+    m_nodes.adopt(ids);
+    m_dist.adopt(dist);
+}
+
+bool Landmarks::load(const MapLoader& ml)
+{
+    clear();
+
+    const MapSnapshot* snap = ml.getSnapshot();
+    if (snap != nullptr && snap->get(SNAP_ALT_NODES, m_nodes) && snap->get(SNAP_ALT_DISTANCES, m_dist) &&
+        !m_nodes.empty())
+        return true;
+
+    clear();
+    return false;
+}
+
+void Landmarks::save(SnapshotWriter& w) const
+{
+    w.add(SNAP_ALT_NODES, m_nodes);
+    w.add(SNAP_ALT_DISTANCES, m_dist);
+}
+
+void Landmarks::addTo(TilePrefetcher& prefetcher) const
+{
+    prefetcher.addNodeArray(m_dist, m_nodes.size());
+}
+
+int Landmarks::views() const
+{
+    return m_nodes.isView() + m_dist.isView();
+}
+
+void Landmarks::addNodes(int numNodes)
+{
+    while (m_dist.size() < static_cast<size_t>(numNodes) * m_nodes.size())
+        m_dist.push_back(-1);
+}
+
+void Landmarks::addEdge(const RoadGraph& graph, int a, int b, double weight, SearchWorkspace& ws)
+{
+    size_t k = m_nodes.size();
+    int n = graph.numNodes();
+    addNodes(n);
+
+    for (size_t i = 0; i < k; i++) {
+
+        ws.reset(n);
+        int ends[2] = { a, b };
+        for (int s = 0; s < 2; s++) {
+            double from = m_dist[ends[s] * k + i];
+            double to = m_dist[ends[1-s] * k + i];
+            if (from >= 0 && (to < 0 || from + weight < to)) {
+                m_dist.edit(ends[1-s] * k + i) = from + weight;
+                ws.reach(ends[1-s], from + weight, -1);
+                ws.push(from + weight, ends[1-s]);
+            }
+        }
+
+            //Dijkstra from what got closer, going on only where it gets other nodes closer too
+        while (!ws.heapEmpty()) {
+
+            int curr = ws.pop().second;
+            if (ws.settled(curr))
+                continue;
+            ws.settle(curr);
+
+            for (int e = graph.edgeBegin(curr); e < graph.edgeEnd(curr); e++) {
+
+                int next = graph.target(e);
+                double newDist = ws.dist(curr) + graph.weight(e);
+                double old = m_dist[next * k + i];
+                if (old < 0 || newDist < old) {
+                    m_dist.edit(next * k + i) = newDist;
+                    ws.reach(next, newDist, curr);
+                    ws.push(newDist, next);
+                }
+            }
+        }
+    }
+}
+
+double Landmarks::lowerBound(int v, int t) const
+{
+    size_t k = m_nodes.size();
+    const double* dv = m_dist.data() + v * k;
+    const double* dt = m_dist.data() + t * k;
+
+    double best = 0;
+    for (size_t i = 0; i < k; i++) {
+        if (dv[i] < 0 || dt[i] < 0)         //landmark is in another part of the map
+            continue;
+        best = max(best, fabs(dt[i] - dv[i]));
+    }
+    return best;
+}
@@ -0,0 +1,72 @@
+// Landmarks.h
+
+#ifndef LANDMARKS_INCLUDED
+#define LANDMARKS_INCLUDED
+
+#include "provided.h"
+#include "support.h"
+#include <vector>
+
+class RoadGraph;
+class SearchWorkspace;
+class TilePrefetcher;
+
+// Landmark distance tables for A* with the ALT heuristic (A*, landmarks,
+// triangle inequality). A few landmark nodes are picked far apart from each
+// other around the edge of the map, and the road distance from every
+// landmark to every node is stored. Since the graph is undirected, for any
+// landmark L the triangle inequality gives
+//      dist(v, t) >= |dist(L, t) - dist(L, v)|
+// and the best of these bounds is a consistent heuristic that, unlike great
+// circle distance, knows about detours around hills, canyons and the coast.
+//
+// The tables are flat so that they can be stored in a map snapshot.
+//
+// An edge added to the graph can only bring nodes closer to a landmark, so
+// addEdge lowers the distances it shortens, spreading out from its ends like
+// Dijkstra but only through the nodes that get closer. Removing an edge makes
+// no change: the tables then only underestimate, and the bounds stay valid.
+
+class Landmarks
+{
+public:
+    static const int defaultCount = 16;
+
+    Landmarks();
+    ~Landmarks();
+
+        //picks count landmarks by farthest-point selection and computes their tables
+    void build(const RoadGraph& graph, int count = defaultCount);
+        //uses the tables compiled into ml's snapshot; false if there are none
+    bool load(const MapLoader& ml);
+    void clear();
+    void save(SnapshotWriter& w) const;
+    bool empty() const { return m_nodes.empty(); }
+
+        //gives the tables nodes up to numNodes, unreachable from every landmark
+    void addNodes(int numNodes);
+        //updates the tables for graph's new edge of weight between a and b, and for any
+        //nodes graph has gained; ws is used for the search
+    void addEdge(const RoadGraph& graph, int a, int b, double weight, SearchWorkspace& ws);
+
+    int numLandmarks() const { return static_cast<int>(m_nodes.size()); }
+    int landmark(int i) const { return m_nodes[i]; }
+
+        //lower bound on the road distance between nodes v and t
+    double lowerBound(int v, int t) const;
+
+        //hands prefetcher the distance tables, which are indexed by node
+    void addTo(TilePrefetcher& prefetcher) const;
+        //how many of the arrays addTo hands over are views into a snapshot
+    int views() const;
+
+      // We prevent a Landmarks object from being copied or assigned.
+    Landmarks(const Landmarks&) = delete;
+    Landmarks& operator=(const Landmarks&) = delete;
+
+private:
+    FlatArray<int32_t> m_nodes;             // the landmarks' node IDs
+    FlatArray<double> m_dist;               // m_dist[v * numLandmarks() + i] = dist(landmark i, v), -1 if unreachable
+};
+
+#endif // LANDMARKS_INCLUDED
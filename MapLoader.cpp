@@ -1,10 +1,197 @@
 #include "provided.h"
+#include "support.h"
+#include "MapSnapshot.h"
+#include "MyMap.h"
 #include <string>
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <thread>
+#include <algorithm>
+#include <functional>
+#include <charconv>
+#include <cstring>
 using namespace std;
 
+namespace {
+
+        //returns the ID of name, adding it to names if it is new
+    int internName(const string& name, vector<string>& names, MyMap<string, int>& ids) {
+
+        const int* id = ids.find(name);
+        if (id != nullptr)
+            return *id;
+
+        int newId = static_cast<int>(names.size());
+        ids.associate(name, newId);
+        names.push_back(name);
+        return newId;
+    }
+
+    // The text format, one record per street segment:
+    //   street name
+    //   lat, lon lat,lon            (either coordinate may use ", " or ",")
+    //   number of attractions
+    //   attraction name|lat, lon    (once per attraction)
+    // Latitudes and longitudes are kept to seven decimals, as mapdata.txt writes them
+    // ("-118.4794734"); the text of any written otherwise goes into a NumberTexts.
+
+    const size_t minChunkBytes = 1 << 18;   //smaller maps are not worth splitting
+
+    struct chunkResult {                    //records parsed from one chunk, names numbered locally
+        chunkResult() : m_ok(false) {}
+        vector<SegmentRecord> m_segments;
+        vector<AttractionRecord> m_attractions;
+        vector<string> m_names;
+        vector<pair<int32_t, string>> m_texts;  //numbers not written the way fixedToText writes them
+        bool m_ok;
+    };
+
+    const char* lineEnd(const char* p, const char* last) {
+        const char* nl = static_cast<const char*>(memchr(p, '\n', last - p));
+        return nl == nullptr ? last : nl;
+    }
+
+    const char* nextLine(const char* p, const char* last) {
+        p = lineEnd(p, last);
+        return p == last ? last : p + 1;
+    }
+
+    string lineText(const char* p, const char* end) {
+        if (end != p && end[-1] == '\r')    //tolerate CRLF files
+            end--;
+        return string(p, end);
+    }
+
+    const char* skipBlanks(const char* p, const char* last) {
+        while (p != last && (*p == ' ' || *p == '\t'))
+            p++;
+        return p;
+    }
+
+        //parses a number, rounded to seven decimals, and returns the end of it, or nullptr.
+        //Unless texts is nullptr, the text is added to it if fixedToText would not write it
+        //back the same: with a '+', leading zeros, "-0", or other than seven decimals
+    const char* parseNumber(const char* p, const char* last, int32_t& value, vector<pair<int32_t, string>>* texts) {
+
+        p = skipBlanks(p, last);
+        const char* end = parseFixed(p, last, value);
+        if (end == nullptr || texts == nullptr)
+            return end;
+
+        const char* digits = (*p == '-') ? p + 1 : p;
+        const char* dot = static_cast<const char*>(memchr(digits, '.', end - digits));
+        if (*p == '+' || dot == nullptr || end - dot != 8 || dot == digits || (*digits == '0' && dot != digits + 1) ||
+            (*p == '-' && value == 0))
+            texts->push_back(make_pair(value, string(p, end)));
+        return end;
+    }
+
+        //parses "lat,lon" or "lat, lon" into fc; returns the end of it, or nullptr
+    const char* parseCoord(const char* p, const char* last, FixedCoord& fc, vector<pair<int32_t, string>>* texts) {
+
+        p = parseNumber(p, last, fc.lat, texts);
+        if (p == nullptr || p == last || *p != ',')
+            return nullptr;
+        return parseNumber(p + 1, last, fc.lon, texts);
+    }
+
+        //true if the line at p looks like the coordinate line of a segment
+    bool isCoordLine(const char* p, const char* last) {
+
+        const char* end = lineEnd(p, last);
+        if (end != p && end[-1] == '\r')
+            end--;
+
+        FixedCoord a, b;
+        p = parseCoord(p, end, a, nullptr);
+        if (p == nullptr)
+            return false;
+        p = parseCoord(p, end, b, nullptr);
+        return p != nullptr && skipBlanks(p, end) == end;
+    }
+
+        //first record start at or after pos: the start of a line followed by a coordinate line
+    const char* recordStartFrom(const char* first, const char* last, const char* pos) {
+
+        if (pos == first)
+            return first;
+
+        const char* line = nextLine(pos - 1, last);     //start of the first whole line at or after pos
+        while (line != last) {
+            const char* following = nextLine(line, last);
+            if (following != last && isCoordLine(following, last))
+                return line;
+            line = following;
+        }
+        return last;
+    }
+
+    void parseChunk(const char* p, const char* last, chunkResult& out) {
+
+        out.m_ok = false;
+        MyMap<string, int> nameIds;
+        const char* prevName = nullptr;                     //the file is sorted by street, so most names repeat the last one
+        size_t prevLength = 0;
+        int prevId = -1;
+
+        while (p != last) {
+
+            const char* end = lineEnd(p, last);             //segment's street name
+            if (skipBlanks(p, end) == end && nextLine(p, last) == last)
+                break;                                      //trailing blank line
+
+            SegmentRecord seg;
+            if (prevName != nullptr && size_t(end - p) == prevLength && memcmp(p, prevName, prevLength) == 0)
+                seg.name = prevId;
+            else {
+                seg.name = internName(lineText(p, end), out.m_names, nameIds);
+                prevName = p;
+                prevLength = end - p;
+                prevId = seg.name;
+            }
+            p = nextLine(p, last);
+
+            end = lineEnd(p, last);                         //starting and ending lat/lon
+            p = parseCoord(p, end, seg.start, &out.m_texts);
+            if (p == nullptr || (p = parseCoord(p, end, seg.end, &out.m_texts)) == nullptr)
+                return;
+            p = nextLine(p, last);
+
+            end = lineEnd(p, last);                         //number of attractions
+            p = skipBlanks(p, end);
+            int attraction_num;
+            from_chars_result r = from_chars(p, end, attraction_num);
+            if (r.ec != errc() || attraction_num < 0)
+                return;
+            p = nextLine(r.ptr, last);
+
+            seg.firstAttraction = static_cast<int32_t>(out.m_attractions.size());
+            seg.numAttractions = attraction_num;
+
+            for (int i = 0; i < attraction_num; i++) {
+
+                const char* bar = static_cast<const char*>(memchr(p, '|', last - p));
+                if (bar == nullptr)
+                    return;
+
+                AttractionRecord att;
+                att.name = internName(string(p, bar), out.m_names, nameIds);
+                end = lineEnd(bar, last);
+                if (parseCoord(bar + 1, end, att.coord, &out.m_texts) == nullptr)
+                    return;
+
+                out.m_attractions.push_back(att);
+                p = nextLine(bar, last);
+            }
+
+            out.m_segments.push_back(seg);
+        }
+
+        out.m_ok = true;
+    }
+}
+
 class MapLoaderImpl
 {
 public:
@@ -13,12 +200,22 @@ public:
 	bool load(string mapFile);
 	size_t getNumSegments() const;
 	bool getSegment(size_t segNum, StreetSegment& seg) const;
+    const MapTables& getTables() const { return m_tables; }
+    MapTables& editTables() { return m_tables; }
+    const MapSnapshot* getSnapshot() const { return m_snapshot.isOpen() ? &m_snapshot : nullptr; }
+    void setParseChunks(int chunks) { m_parseChunks = max(0, chunks); }
+    int getParseChunks() const { return m_chunksUsed; }
 private:
-    size_t m_numSegments;
-    vector<StreetSegment> m_segments;
+    MapTables m_tables;                     //coordinates are kept in fixed point, see support.h
+    MapSnapshot m_snapshot;                 //backs m_tables when the map came from a snapshot
+    int m_parseChunks;                      //chunks to cut a text map into; 0 for one per core
+    int m_chunksUsed;                       //chunks the last load parsed
+    
+    /* private member functions */
+    bool loadText(string mapFile);
 };
 
-MapLoaderImpl::MapLoaderImpl() : m_numSegments(0)
+MapLoaderImpl::MapLoaderImpl() : m_parseChunks(0), m_chunksUsed(0)
 {
 }
 
@@ -28,75 +225,227 @@ MapLoaderImpl::~MapLoaderImpl()
 
 bool MapLoaderImpl::load(string mapFile)
 {
-    ifstream infile(mapFile);
+    m_tables.clear();
+    m_snapshot.close();
+    m_chunksUsed = 0;
+    
+    string snapFile;
+    if (MapSnapshot::findFor(mapFile, snapFile)) {
+        
+        if (m_snapshot.open(snapFile) && m_tables.load(m_snapshot))
+            return true;
+        
+        m_tables.clear();                                   //damaged or outdated snapshot
+        m_snapshot.close();
+        if (snapFile == mapFile)
+            return false;
+    }
+    
+    return loadText(mapFile);
+}
+
+size_t MapLoaderImpl::getNumSegments() const
+{
+    return m_tables.segments.size();
+}
+
+bool MapLoaderImpl::getSegment(size_t segNum, StreetSegment &seg) const
+{
+    if (segNum >= m_tables.segments.size())
+        return false;
+    
+    buildStreetSegment(m_tables, segNum, seg);
+	return true;
+}
+
+/* private member functions */
+
+bool MapLoaderImpl::loadText(string mapFile)
+{
+    ifstream infile(mapFile, ios::binary | ios::ate);      //read the whole file into one buffer
     if (!infile)
         return false;
     
-    string s;
+    vector<char> buffer(static_cast<size_t>(infile.tellg()));
+    infile.seekg(0);
+    if (!infile.read(buffer.data(), buffer.size()))
+        return false;
     
-    while (getline(infile, s)) {                            //segment's street name contained in s
-        
-        string lat_begin, lon_begin, lat_end, lon_end;
-        
-        getline(infile, lat_begin, ',');                    //starting lat/lon
-        infile >> lon_begin;
-        
-        infile.ignore(1);
-        getline(infile, lat_end, ',');                      //ending lat/lon
-        infile >> lon_end;
-        
-        GeoCoord gc1(lat_begin, lon_begin);
-        GeoCoord gc2(lat_end, lon_end);
+    const char* first = buffer.data();
+    const char* last = first + buffer.size();
+    
+        //split into record-aligned chunks, one per thread
+    size_t numChunks = m_parseChunks;
+    if (numChunks == 0) {
+        size_t threads = max(1u, thread::hardware_concurrency());
+        numChunks = max<size_t>(1, min(threads, buffer.size() / minChunkBytes));
+    }
+    
+    vector<const char*> bounds;
+    bounds.push_back(first);
+    for (size_t c = 1; c < numChunks; c++) {
+        const char* b = recordStartFrom(first, last, first + buffer.size() * c / numChunks);
+        if (b > bounds.back())
+            bounds.push_back(b);
+    }
+    bounds.push_back(last);
+    
+    vector<chunkResult> chunks(bounds.size() - 1);
+    vector<thread> workers;
+    for (size_t c = 1; c < chunks.size(); c++)
+        workers.push_back(thread(parseChunk, bounds[c], bounds[c+1], ref(chunks[c])));
+    parseChunk(bounds[0], bounds[1], chunks[0]);
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+    
+    bool ok = true;
+    for (size_t c = 0; c < chunks.size(); c++)
+        ok = ok && chunks[c].m_ok;
+    
+    if (!ok && chunks.size() > 1) {                         //a split landed somewhere odd; parse it all in one go
+        chunks.assign(1, chunkResult());
+        parseChunk(first, last, chunks[0]);
+        ok = chunks[0].m_ok;
+    }
+    if (!ok)
+        return false;                                       //bad format
+    m_chunksUsed = static_cast<int>(chunks.size());
+    
+    vector<char>().swap(buffer);                            //the records no longer refer to the text
+    
+        //merge in the original segment order, renumbering names and attractions; each chunk is
+        //freed as soon as it has been copied, so that the records are only ever held about once
+    size_t numSegments = 0, numAttractions = 0;
+    for (size_t c = 0; c < chunks.size(); c++) {
+        numSegments += chunks[c].m_segments.size();
+        numAttractions += chunks[c].m_attractions.size();
+    }
+    
+    vector<SegmentRecord> segments;
+    vector<AttractionRecord> attractions;
+    segments.reserve(numSegments);
+    attractions.reserve(numAttractions);
+    MyMap<string, int> nameIds;                             //each distinct name is stored once
+    vector<pair<int32_t, string>> texts;
+    
+    for (size_t c = 0; c < chunks.size(); c++) {
         
-        StreetSegment street_segment;
-        street_segment.streetName = s;
-        street_segment.segment = GeoSegment(gc1, gc2);
+        chunkResult chunk = move(chunks[c]);
+        texts.insert(texts.end(), chunk.m_texts.begin(), chunk.m_texts.end());
         
-        infile.ignore(10000, '\n');
+        vector<int> globalName(chunk.m_names.size());
+        for (size_t i = 0; i < chunk.m_names.size(); i++) {
+            const int* id = nameIds.find(chunk.m_names[i]);
+            if (id != nullptr)
+                globalName[i] = *id;
+            else {
+                globalName[i] = m_tables.names.add(chunk.m_names[i]);
+                nameIds.associate(chunk.m_names[i], globalName[i]);
+            }
+        }
         
-        int attraction_num;                                 //number of attractions
-        infile >> attraction_num;
+        int32_t attBase = static_cast<int32_t>(attractions.size());
         
-        infile.ignore(10000, '\n');
+        for (size_t i = 0; i < chunk.m_attractions.size(); i++) {
+            AttractionRecord att = chunk.m_attractions[i];
+            att.name = globalName[att.name];
+            attractions.push_back(att);
+        }
         
-        for (int i = 0; i < attraction_num; i++) {
-            
-            string attraction_name;                         //attraction name
-            getline(infile, attraction_name, '|');
-            string attraction_lat, attraction_lon;
-            
-            getline(infile, attraction_lat, ',');           //attraction lat/lon
-            infile >> attraction_lon;
-            
-            GeoCoord gc(attraction_lat, attraction_lon);    //create Attraction object
-            Attraction att;
-            att.name = attraction_name;
-            att.geocoordinates = gc;
-            
-            street_segment.attractions.push_back(att);
-            
-            infile.ignore(10000, '\n');
+        for (size_t i = 0; i < chunk.m_segments.size(); i++) {
+            SegmentRecord seg = chunk.m_segments[i];
+            seg.name = globalName[seg.name];
+            seg.firstAttraction += attBase;
+            segments.push_back(seg);
         }
-     
-        m_segments.push_back(street_segment);
-        m_numSegments++;
     }
     
+    m_tables.segments.adopt(segments);
+    m_tables.attractions.adopt(attractions);
+    m_tables.numberTexts.build(texts);
+    
 	return true;
 }
 
-size_t MapLoaderImpl::getNumSegments() const
+//******************** MapTables functions ************************************
+
+void MapTables::share(const MapTables& other)
 {
-    return m_numSegments;
+    segments.view(other.segments.data(), other.segments.size());
+    attractions.view(other.attractions.data(), other.attractions.size());
+    names.m_chars.view(other.names.m_chars.data(), other.names.m_chars.size());
+    names.m_offsets.view(other.names.m_offsets.data(), other.names.m_offsets.size());
+    numberTexts.m_values.view(other.numberTexts.m_values.data(), other.numberTexts.m_values.size());
+    numberTexts.m_texts.m_chars.view(other.numberTexts.m_texts.m_chars.data(), other.numberTexts.m_texts.m_chars.size());
+    numberTexts.m_texts.m_offsets.view(other.numberTexts.m_texts.m_offsets.data(), other.numberTexts.m_texts.m_offsets.size());
+    nameIds.clear();
 }
 
-bool MapLoaderImpl::getSegment(size_t segNum, StreetSegment &seg) const
+void MapTables::save(SnapshotWriter& w) const
 {
-    if (segNum >= m_numSegments)
-        return false;
+    w.add(SNAP_SEGMENTS, segments);
+    w.add(SNAP_ATTRACTIONS, attractions);
+    w.add(SNAP_NAME_CHARS, names.m_chars);
+    w.add(SNAP_NAME_OFFSETS, names.m_offsets);
+    w.add(SNAP_NUMBER_VALUES, numberTexts.m_values);
+    w.add(SNAP_NUMBER_CHARS, numberTexts.m_texts.m_chars);
+    w.add(SNAP_NUMBER_OFFSETS, numberTexts.m_texts.m_offsets);
+}
+
+bool MapTables::load(const MapSnapshot& snap)
+{
+    return snap.get(SNAP_SEGMENTS, segments) && snap.get(SNAP_ATTRACTIONS, attractions) &&
+           snap.get(SNAP_NAME_CHARS, names.m_chars) && snap.get(SNAP_NAME_OFFSETS, names.m_offsets) &&
+           snap.get(SNAP_NUMBER_VALUES, numberTexts.m_values) && snap.get(SNAP_NUMBER_CHARS, numberTexts.m_texts.m_chars) &&
+           snap.get(SNAP_NUMBER_OFFSETS, numberTexts.m_texts.m_offsets);
+}
+
+int MapTables::intern(const string& name)
+{
+    if (nameIds.size() == 0)
+        for (int id = 0; id < names.size(); id++)
+            nameIds.associate(names.get(id), id);
     
-    seg = m_segments[segNum];
-	return true;
+    const int* id = nameIds.find(name);
+    if (id != nullptr)
+        return *id;
+    
+    int added = names.add(name);
+    nameIds.associate(name, added);
+    return added;
+}
+
+int MapTables::addSegment(int name, const FixedCoord& start, const FixedCoord& end)
+{
+    SegmentRecord rec = { name, start, end, static_cast<int32_t>(attractions.size()), 0 };
+    segments.push_back(rec);
+    return static_cast<int>(segments.size()) - 1;
+}
+
+void MapTables::addAttraction(int segment, int name, const FixedCoord& coord)
+{
+    SegmentRecord& rec = segments.edit(segment);
+    
+    if (rec.firstAttraction + rec.numAttractions != static_cast<int32_t>(attractions.size())) {
+        int32_t first = static_cast<int32_t>(attractions.size());
+        for (int i = 0; i < rec.numAttractions; i++)
+            attractions.push_back(attractions[rec.firstAttraction + i]);
+        rec.firstAttraction = first;
+    }
+    
+    AttractionRecord att = { name, coord };
+    attractions.push_back(att);
+    rec.numAttractions++;
+}
+
+void MapTables::removeAttraction(int segment, int index)
+{
+    SegmentRecord& rec = segments.edit(segment);
+    for (int i = index; i + 1 < rec.numAttractions; i++) {
+        AttractionRecord next = attractions[rec.firstAttraction + i + 1];
+        attractions.edit(rec.firstAttraction + i) = next;
+    }
+    rec.numAttractions--;
 }
 
 //******************** MapLoader functions ************************************
@@ -128,3 +477,28 @@ bool MapLoader::getSegment(size_t segNum, StreetSegment& seg) const
 {
    return m_impl->getSegment(segNum, seg);
 }
+
+const MapTables& MapLoader::getTables() const
+{
+   return m_impl->getTables();
+}
+
+MapTables& MapLoader::editTables()
+{
+   return m_impl->editTables();
+}
+
+const MapSnapshot* MapLoader::getSnapshot() const
+{
+   return m_impl->getSnapshot();
+}
+
+void MapLoader::setParseChunks(int chunks)
+{
+   m_impl->setParseChunks(chunks);
+}
+
+int MapLoader::getParseChunks() const
+{
+   return m_impl->getParseChunks();
+}
@@ -0,0 +1,324 @@
+#include "MapSnapshot.h"
+#include "RoadGraph.h"
+#include "ContractionHierarchy.h"
+#include "Landmarks.h"
+#include "SpatialIndex.h"
+#include "provided.h"
+#include "support.h"
+#include <string>
+#include <vector>
+#include <thread>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+namespace {
+
+    const char magic[8] = { 'B', 'N', 'A', 'V', 'S', 'N', 'A', 'P' };
+    const uint32_t formatVersion = 4;             //2: RoadGraph numbers its nodes tile by tile
+                                                  //3: source time in nanoseconds
+                                                  //4: text of numbers not written with seven decimals
+    const uint32_t byteOrderTag = 0x01020304;      //reads back differently on a machine of the other endianness
+
+    struct FileHeader {
+        char m_magic[8];
+        uint32_t m_version;
+        uint32_t m_byteOrder;
+        uint64_t m_sourceSize;                      //size and modification time of the text map it was compiled from,
+        int64_t m_sourceTime;                       //the time in nanoseconds so that an edit within a second shows
+        uint64_t m_checksum;                        //over everything after the header
+        uint32_t m_numSections;
+        uint32_t m_reserved;
+    };
+
+    struct SectionEntry {
+        uint32_t m_id;
+        uint32_t m_elemSize;
+        uint64_t m_offset;                          //from the start of the file, a multiple of 8
+        uint64_t m_count;
+    };
+
+    uint64_t checksum(const char* data, size_t size) {
+
+        //word-at-a-time multiplicative hash; size is always a multiple of 8 here
+
+        uint64_t h = 0xcbf29ce484222325ULL;
+        for (size_t i = 0; i + 8 <= size; i += 8) {
+            uint64_t w;
+            memcpy(&w, data + i, 8);
+            h = (h ^ w) * 0x100000001b3ULL;
+            h ^= h >> 29;
+        }
+        return h;
+    }
+
+    bool sourceStamp(const string& file, uint64_t& size, int64_t& time) {
+
+        struct stat st;
+        if (stat(file.c_str(), &st) != 0)
+            return false;
+
+#if defined(__APPLE__)
+        long nanoseconds = st.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+        long nanoseconds = 0;
+#else
+        long nanoseconds = st.st_mtim.tv_nsec;
+#endif
+        size = static_cast<uint64_t>(st.st_size);
+        time = static_cast<int64_t>(st.st_mtime) * 1000000000 + nanoseconds;
+        return true;
+    }
+
+    bool readHeader(const string& file, FileHeader& header) {
+
+        ifstream in(file, ios::binary);
+        if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)))
+            return false;
+
+        return memcmp(header.m_magic, magic, sizeof(magic)) == 0;
+    }
+}
+
+//******************** SnapshotWriter functions *******************************
+
+void SnapshotWriter::addRaw(uint32_t id, uint32_t elemSize, const void* data, uint64_t count)
+{
+    Pending p;
+    p.m_id = id;
+    p.m_elemSize = elemSize;
+    p.m_bytes.assign(static_cast<const char*>(data), static_cast<const char*>(data) + elemSize * count);
+    m_sections.push_back(p);
+}
+
+bool SnapshotWriter::write(const string& file, const string& sourceFile) const
+{
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.m_magic, magic, sizeof(magic));
+    header.m_version = formatVersion;
+    header.m_byteOrder = byteOrderTag;
+    header.m_numSections = static_cast<uint32_t>(m_sections.size());
+    sourceStamp(sourceFile, header.m_sourceSize, header.m_sourceTime);
+
+        //lay out the section table and the 8-byte aligned section bodies after the header
+    vector<char> body(m_sections.size() * sizeof(SectionEntry), 0);
+    uint64_t offset = sizeof(header) + body.size();
+
+    for (size_t i = 0; i < m_sections.size(); i++) {
+
+        const Pending& p = m_sections[i];
+
+        SectionEntry entry;
+        entry.m_id = p.m_id;
+        entry.m_elemSize = p.m_elemSize;
+        entry.m_offset = offset;
+        entry.m_count = p.m_elemSize == 0 ? 0 : p.m_bytes.size() / p.m_elemSize;
+        memcpy(&body[i * sizeof(SectionEntry)], &entry, sizeof(entry));
+
+        body.insert(body.end(), p.m_bytes.begin(), p.m_bytes.end());
+        body.resize((body.size() + 7) / 8 * 8, 0);
+        offset = sizeof(header) + body.size();
+    }
+
+    header.m_checksum = checksum(body.data(), body.size());
+
+        //write beside the target and rename, so a reader never maps a half-written file
+    string temp = file + ".tmp";
+    {
+        ofstream out(temp, ios::binary | ios::trunc);
+        if (!out)
+            return false;
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(body.data(), body.size());
+        if (!out) {
+            remove(temp.c_str());
+            return false;
+        }
+    }
+
+#ifdef _WIN32
+    remove(file.c_str());
+#endif
+    return rename(temp.c_str(), file.c_str()) == 0;
+}
+
+//******************** MapSnapshot functions **********************************
+
+MapSnapshot::MapSnapshot() : m_base(nullptr), m_size(0), m_mapped(false)
+{
+}
+
+MapSnapshot::~MapSnapshot()
+{
+    close();
+}
+
+bool MapSnapshot::open(const string& file)
+{
+    close();
+
+#ifndef _WIN32
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(FileHeader))) {
+        ::close(fd);
+        return false;
+    }
+
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);                                    //the mapping stays valid without the descriptor
+    if (addr == MAP_FAILED)
+        return false;
+
+    m_base = static_cast<const char*>(addr);
+    m_size = st.st_size;
+    m_mapped = true;
+#else
+    ifstream in(file, ios::binary | ios::ate);      //no mmap here; read the file into an aligned buffer
+    if (!in)
+        return false;
+
+    size_t size = static_cast<size_t>(in.tellg());
+    if (size < sizeof(FileHeader))
+        return false;
+
+    uint64_t* buffer = new uint64_t[(size + 7) / 8];
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(buffer), size);
+
+    m_base = reinterpret_cast<const char*>(buffer);
+    m_size = size;
+    m_mapped = false;
+#endif
+
+    const FileHeader* header = reinterpret_cast<const FileHeader*>(m_base);
+
+    if (memcmp(header->m_magic, magic, sizeof(magic)) != 0 || header->m_version != formatVersion ||
+        header->m_byteOrder != byteOrderTag ||
+        sizeof(FileHeader) + header->m_numSections * sizeof(SectionEntry) > m_size ||
+        checksum(m_base + sizeof(FileHeader), m_size - sizeof(FileHeader)) != header->m_checksum) {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void MapSnapshot::close()
+{
+    if (m_base == nullptr)
+        return;
+
+#ifndef _WIN32
+    if (m_mapped)
+        munmap(const_cast<char*>(m_base), m_size);
+    else
+#endif
+        delete [] reinterpret_cast<const uint64_t*>(m_base);
+
+    m_base = nullptr;
+    m_size = 0;
+    m_mapped = false;
+}
+
+bool MapSnapshot::isSnapshotFile(const string& file)
+{
+    FileHeader header;
+    return readHeader(file, header);
+}
+
+bool MapSnapshot::findFor(const string& mapFile, string& snapFile)
+{
+    if (isSnapshotFile(mapFile)) {
+        snapFile = mapFile;
+        return true;
+    }
+
+    string candidate = mapFile + ".snap";
+    FileHeader header;
+    uint64_t size;
+    int64_t time;
+
+    if (!readHeader(candidate, header) || !sourceStamp(mapFile, size, time))
+        return false;
+
+    if (header.m_sourceSize != size || header.m_sourceTime != time)    //text has changed since it was compiled
+        return false;
+
+    snapFile = candidate;
+    return true;
+}
+
+/* private member functions */
+
+bool MapSnapshot::findSection(uint32_t id, uint32_t elemSize, const void*& data, uint64_t& count) const
+{
+    if (m_base == nullptr)
+        return false;
+
+    const FileHeader* header = reinterpret_cast<const FileHeader*>(m_base);
+    const SectionEntry* table = reinterpret_cast<const SectionEntry*>(m_base + sizeof(FileHeader));
+
+    for (uint32_t i = 0; i < header->m_numSections; i++) {
+
+        if (table[i].m_id != id)
+            continue;
+
+        if (table[i].m_elemSize != elemSize || table[i].m_offset + table[i].m_count * elemSize > m_size)
+            return false;
+
+        data = m_base + table[i].m_offset;
+        count = table[i].m_count;
+        return true;
+    }
+    return false;
+}
+
+//******************** snapshot compiler **************************************
+
+bool compileMapSnapshot(const string& mapFile, const string& snapFile)
+{
+    MapLoader loader;
+    if (!loader.load(mapFile))
+        return false;
+
+        //the indexes are built at once, each reading only the loader's tables or the graph
+    AttractionMapper attractions;
+    SpatialIndex grid;
+    thread attractionsBuild([&attractions, &loader] { attractions.init(loader); });
+    thread gridBuild([&grid, &loader] { grid.build(loader); });
+
+    RoadGraph graph;
+    graph.build(loader);
+
+    ContractionHierarchy hierarchy;
+    Landmarks landmarks;
+    thread landmarksBuild([&landmarks, &graph] { landmarks.build(graph); });
+    hierarchy.build(graph);
+
+    attractionsBuild.join();
+    gridBuild.join();
+    landmarksBuild.join();
+
+    SnapshotWriter writer;
+    loader.getTables().save(writer);
+    attractions.save(writer);
+    graph.save(writer);
+    hierarchy.save(writer);
+    landmarks.save(writer);
+    grid.save(writer);
+
+    return writer.write(snapFile, mapFile);
+}
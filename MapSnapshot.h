@@ -0,0 +1,103 @@
+// MapSnapshot.h
+
+#ifndef MAPSNAPSHOT_INCLUDED
+#define MAPSNAPSHOT_INCLUDED
+
+#include "support.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// A precompiled, read-only image of a loaded map. The file is a header, a
+// table of sections and the sections themselves, each an 8-byte aligned array
+// of fixed-layout records in host byte order. Opening a snapshot maps the file
+// into memory and the map's tables are used in place, so nothing is parsed.
+//
+// Snapshots are written by MapCompiler (tools/MapCompiler.cpp). MapLoader::load
+// uses one when it is given a snapshot file, or when "<mapFile>.snap" exists
+// and was compiled from the current version of mapFile.
+
+    // Section IDs are stored in the files, so new sections go at the end. A reader
+    // that misses a section it wants rebuilds that structure from the tables.
+enum SnapshotSection {
+    SNAP_SEGMENTS = 1, SNAP_ATTRACTIONS, SNAP_NAME_CHARS, SNAP_NAME_OFFSETS,        // MapTables
+    SNAP_ATTINDEX_CHARS, SNAP_ATTINDEX_OFFSETS, SNAP_ATTINDEX_COORDS,               // AttractionMapper
+    SNAP_GRAPH_COORDS, SNAP_GRAPH_OFFSETS, SNAP_GRAPH_TARGETS,                      // RoadGraph
+    SNAP_GRAPH_WEIGHTS, SNAP_GRAPH_NAMES,
+    SNAP_CH_OFFSETS, SNAP_CH_TARGETS, SNAP_CH_WEIGHTS, SNAP_CH_MIDDLES,              // ContractionHierarchy
+    SNAP_ALT_NODES, SNAP_ALT_DISTANCES,                                             // Landmarks
+    SNAP_GRAPH_BEARINGS,                                                            // RoadGraph
+    SNAP_CH_EDGES,                                                                  // ContractionHierarchy
+    SNAP_GRID_SHAPE, SNAP_GRID_OFFSETS, SNAP_GRID_ENTRIES,                          // SpatialIndex
+    SNAP_ATTINDEX_DISPLAY_CHARS, SNAP_ATTINDEX_DISPLAY_OFFSETS,                     // AttractionMapper
+    SNAP_ATTINDEX_GRAMS, SNAP_ATTINDEX_GRAM_OFFSETS, SNAP_ATTINDEX_GRAM_NAMES,
+    SNAP_ATTINDEX_WORDS, SNAP_ATTINDEX_SEGMENTS,
+    SNAP_GRAPH_TILE_SHAPE, SNAP_GRAPH_TILE_NODES,                                   // RoadGraph
+    SNAP_NUMBER_VALUES, SNAP_NUMBER_CHARS, SNAP_NUMBER_OFFSETS                      // MapTables
+};
+
+class SnapshotWriter
+{
+public:
+    template<typename T>
+    void add(uint32_t id, const FlatArray<T>& array) { addRaw(id, sizeof(T), array.data(), array.size()); }
+    void addRaw(uint32_t id, uint32_t elemSize, const void* data, uint64_t count);
+
+        //writes the snapshot, stamped with the size and modification time (to the nanosecond) of sourceFile
+    bool write(const std::string& file, const std::string& sourceFile) const;
+
+private:
+    struct Pending {
+        uint32_t m_id;
+        uint32_t m_elemSize;
+        std::vector<char> m_bytes;
+    };
+    std::vector<Pending> m_sections;
+};
+
+class MapSnapshot
+{
+public:
+    MapSnapshot();
+    ~MapSnapshot();
+
+        //maps file and checks its magic number, version and checksum
+    bool open(const std::string& file);
+    void close();
+    bool isOpen() const { return m_base != nullptr; }
+    bool isMapped() const { return m_mapped; }   // false if the file was read into memory instead
+
+        //points array at section id inside the mapping; false if it is missing or has the wrong record size
+    template<typename T>
+    bool get(uint32_t id, FlatArray<T>& array) const
+    {
+        const void* data;
+        uint64_t count;
+        if (!findSection(id, sizeof(T), data, count))
+            return false;
+        array.view(static_cast<const T*>(data), count);
+        return true;
+    }
+
+        //returns true if file starts like a snapshot
+    static bool isSnapshotFile(const std::string& file);
+
+        //if mapFile is a snapshot, or has an up-to-date "<mapFile>.snap" beside it, sets snapFile and returns true
+    static bool findFor(const std::string& mapFile, std::string& snapFile);
+
+      // We prevent a MapSnapshot object from being copied or assigned.
+    MapSnapshot(const MapSnapshot&) = delete;
+    MapSnapshot& operator=(const MapSnapshot&) = delete;
+
+private:
+    const char* m_base;
+    size_t m_size;
+    bool m_mapped;                  // false if the file had to be read into a heap buffer
+
+    bool findSection(uint32_t id, uint32_t elemSize, const void*& data, uint64_t& count) const;
+};
+
+    //parses mapFile and writes the compiled snapshot to snapFile
+bool compileMapSnapshot(const std::string& mapFile, const std::string& snapFile);
+
+#endif // MAPSNAPSHOT_INCLUDED
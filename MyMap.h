@@ -1,6 +1,22 @@
 // MyMap.h
 
-template<typename KeyType, typename ValueType>
+#ifndef MYMAP_INCLUDED
+#define MYMAP_INCLUDED
+
+#include <functional>
+#include <vector>
+#include <cstddef>
+
+// An open-addressing hash map. The key/value pairs are kept densely in an array
+// (in insertion order until something is removed), and a power-of-two table of (hash, entry index) slots is probed
+// linearly to find them, so a lookup touches one or two cache lines instead of
+// walking a chain of tree nodes.
+//
+// KeyType must be equality comparable and hashable with Hash (std::hash by
+// default; support.h provides std::hash<GeoCoord>). Pointers returned by find
+// stay valid until the next call to associate, remove or clear.
+
+template<typename KeyType, typename ValueType, typename Hash = std::hash<KeyType>>
 class MyMap
 {
 public:
@@ -9,6 +25,7 @@ public:
 	void clear();
 	int size() const;
 	void associate(const KeyType& key, const ValueType& value);
+	bool remove(const KeyType& key);        // false if key was not present
 
 	  // for a map that can't be modified, return a pointer to const ValueType
 	const ValueType* find(const KeyType& key) const;
@@ -25,117 +42,165 @@ public:
 
 private:
 
-    struct Node {
-        
-        Node(KeyType key, ValueType val, Node* left, Node* right)
-         : m_key(key), m_val(val), m_left(left), m_right(right)
+    struct Entry {
+
+        Entry(const KeyType& key, const ValueType& val)
+         : m_key(key), m_val(val)
         {}
-        
+
         KeyType m_key;
         ValueType m_val;
-        Node* m_left;
-        Node* m_right;
     };
-    
-    int m_size;
-    Node* m_root;
-    
+
+    struct Slot {
+        size_t m_hash;
+        int m_entry;                // index into m_entries, -1 if the slot is empty
+    };
+
+    std::vector<Entry> m_entries;
+    std::vector<Slot> m_slots;      // size is zero or a power of two
+    Hash m_hasher;
+
     /* private member functions */
-    void clearAux(Node* &root);
-    void associateAux(const KeyType& key, const ValueType& value, Node* &root);
-    ValueType* findAux(const KeyType& key, Node* root) const;
+    size_t hashOf(const KeyType& key) const;
+    int findSlot(const KeyType& key, size_t hash) const;    // slot holding key, or the empty slot where it belongs
+    void grow();
 };
 
-template<typename KeyType, typename ValueType>
-MyMap<KeyType, ValueType>::MyMap() : m_size(0), m_root(nullptr) {}
+template<typename KeyType, typename ValueType, typename Hash>
+MyMap<KeyType, ValueType, Hash>::MyMap() {}
 
-template<typename KeyType, typename ValueType>
-MyMap<KeyType, ValueType>::~MyMap() {
+template<typename KeyType, typename ValueType, typename Hash>
+MyMap<KeyType, ValueType, Hash>::~MyMap() {
     clear();
 }
 
-template<typename KeyType, typename ValueType>
-void MyMap<KeyType, ValueType>::clear() {
-    clearAux(m_root);
-    m_size=0;
+template<typename KeyType, typename ValueType, typename Hash>
+void MyMap<KeyType, ValueType, Hash>::clear() {
+    m_entries.clear();
+    m_slots.clear();
 }
 
-template<typename KeyType, typename ValueType>
-int MyMap<KeyType, ValueType>::size() const { return m_size; }
+template<typename KeyType, typename ValueType, typename Hash>
+int MyMap<KeyType, ValueType, Hash>::size() const { return static_cast<int>(m_entries.size()); }
 
-template<typename KeyType, typename ValueType>
-void MyMap<KeyType, ValueType>::associate(const KeyType &key, const ValueType &value) {
-    associateAux(key, value, m_root);
-}
+template<typename KeyType, typename ValueType, typename Hash>
+void MyMap<KeyType, ValueType, Hash>::associate(const KeyType &key, const ValueType &value) {
 
-template<typename KeyType, typename ValueType>
-const ValueType* MyMap<KeyType, ValueType>::find(const KeyType &key) const {
-    return findAux(key, m_root);
-}
+    if ((m_entries.size() + 1) * 4 > m_slots.size() * 3)    //keep the load factor under 3/4
+        grow();
 
-/* private member functions */
+    size_t hash = hashOf(key);
+    int slot = findSlot(key, hash);
 
-template<typename KeyType, typename ValueType>
-void MyMap<KeyType, ValueType>::clearAux(MyMap::Node* &root) {
-    
-    if(root == nullptr)
+    if (m_slots[slot].m_entry != -1) {      //key already present
+        m_entries[m_slots[slot].m_entry].m_val = value;
         return;
-    
-    if (root->m_left != nullptr)
-        clearAux(root->m_left);
-    
-    if (root->m_right != nullptr)
-        clearAux(root->m_right);
-    
-    delete root;
-    root = nullptr;
+    }
+
+    m_slots[slot].m_hash = hash;
+    m_slots[slot].m_entry = static_cast<int>(m_entries.size());
+    m_entries.push_back(Entry(key, value));
 }
 
-template<typename KeyType, typename ValueType>
-void MyMap<KeyType, ValueType>::associateAux(const KeyType &key, const ValueType &value, Node* &root) {
-    
-    if (root == nullptr) {
-        root = new Node(key, value, nullptr, nullptr);
-        m_size++;
-        return;
+template<typename KeyType, typename ValueType, typename Hash>
+bool MyMap<KeyType, ValueType, Hash>::remove(const KeyType &key) {
+
+    if (m_slots.empty())
+        return false;
+
+    size_t mask = m_slots.size() - 1;
+    size_t hole = static_cast<size_t>(findSlot(key, hashOf(key)));
+    int entry = m_slots[hole].m_entry;
+    if (entry == -1)
+        return false;
+
+        //backward-shift deletion: pull later members of the probe run into the hole, so
+        //that no lookup is cut short by an empty slot and no tombstones are needed
+    for (size_t j = (hole + 1) & mask; m_slots[j].m_entry != -1; j = (j + 1) & mask) {
+
+        size_t home = m_slots[j].m_hash & mask;
+        bool canMove = (hole <= j) ? (home <= hole || home > j) : (home <= hole && home > j);
+        if (canMove) {
+            m_slots[hole] = m_slots[j];
+            hole = j;
+        }
     }
-    
-    if (root->m_key == key) {
-        root->m_val = value;
-        return;
+    m_slots[hole].m_entry = -1;
+
+        //keep the entries dense by moving the last one into the gap
+    int last = static_cast<int>(m_entries.size()) - 1;
+    if (entry != last) {
+        const KeyType& lastKey = m_entries[last].m_key;
+        m_slots[findSlot(lastKey, hashOf(lastKey))].m_entry = entry;
+        m_entries[entry] = m_entries[last];
     }
-    
-    if (root->m_key < key)
-        associateAux(key, value, root->m_right);
-    else
-        associateAux(key, value, root->m_left);
+    m_entries.pop_back();
+    return true;
 }
 
-template<typename KeyType, typename ValueType>
-ValueType* MyMap<KeyType, ValueType>::findAux(const KeyType &key, Node *root) const {
-    
-    if (root == nullptr)
+template<typename KeyType, typename ValueType, typename Hash>
+const ValueType* MyMap<KeyType, ValueType, Hash>::find(const KeyType &key) const {
+
+    if (m_slots.empty())
+        return nullptr;
+
+    int slot = findSlot(key, hashOf(key));
+    if (m_slots[slot].m_entry == -1)
         return nullptr;
-    
-    if (root->m_key == key)
-        return &(root->m_val);
-    
-    if (root->m_key < key)
-        return findAux(key, root->m_right);
-    else
-        return findAux(key, root->m_left);
+
+    return &(m_entries[m_slots[slot].m_entry].m_val);
+}
+
+/* private member functions */
+
+template<typename KeyType, typename ValueType, typename Hash>
+size_t MyMap<KeyType, ValueType, Hash>::hashOf(const KeyType &key) const {
+
+        //Fibonacci mixing so that weak hashes (e.g. identity on integers) still spread over the table
+    unsigned long long h = static_cast<unsigned long long>(m_hasher(key)) * 0x9E3779B97F4A7C15ULL;
+    return static_cast<size_t>(h ^ (h >> 32));
+}
+
+template<typename KeyType, typename ValueType, typename Hash>
+int MyMap<KeyType, ValueType, Hash>::findSlot(const KeyType &key, size_t hash) const {
+
+    size_t mask = m_slots.size() - 1;
+
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {    //linear probing; never full, so this terminates
+
+        const Slot& s = m_slots[i];
+
+        if (s.m_entry == -1)
+            return static_cast<int>(i);
+
+        if (s.m_hash == hash && m_entries[s.m_entry].m_key == key)
+            return static_cast<int>(i);
+    }
+}
+
+template<typename KeyType, typename ValueType, typename Hash>
+void MyMap<KeyType, ValueType, Hash>::grow() {
+
+    size_t capacity = m_slots.empty() ? 16 : m_slots.size() * 2;
+    Slot empty = { 0, -1 };
+
+    std::vector<Slot> old(capacity, empty);
+    old.swap(m_slots);
+
+    size_t mask = capacity - 1;
+
+    for (size_t j = 0; j < old.size(); j++) {              //reinsert every entry using its cached hash
+
+        if (old[j].m_entry == -1)
+            continue;
+
+        size_t i = old[j].m_hash & mask;
+        while (m_slots[i].m_entry != -1)
+            i = (i + 1) & mask;
+
+        m_slots[i] = old[j];
+    }
 }
 
-/*
- void tempPrintTree(Node* root, int depth) {
- if (root == nullptr)
- return;
- std::cerr << std::string(2*depth, ' ') << root->m_key << ": " << root->m_val << std::endl;
- tempPrintTree(root->m_left, depth+1);
- tempPrintTree(root->m_right, depth+1);
- }
- 
- void tempPrintTree() {
- tempPrintTree(m_root, 0);
- }
-*/
+#endif // MYMAP_INCLUDED
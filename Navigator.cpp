@@ -1,13 +1,54 @@
 #include "provided.h"
 #include "support.h"
 #include "MyMap.h"
+#include "RoadGraph.h"
+#include "MapSnapshot.h"
+#include "SpatialIndex.h"
+#include "SearchWorkspace.h"
+#include "ContractionHierarchy.h"
+#include "Landmarks.h"
+#include "RouteCache.h"
+#include "TilePrefetcher.h"
 #include <string>
 #include <algorithm>
 #include <vector>
-#include <queue>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
 using namespace std;
 
-typedef pair<double, GeoCoord> coordPair;
+namespace {
+
+        //runs tasks on up to numThreads threads, the calling thread among them, each thread
+        //taking the next task no thread has started
+    void runTasks(const vector<function<void()>>& tasks, int numThreads) {
+
+        atomic<size_t> next(0);
+        auto worker = [&tasks, &next] {
+            for (size_t i = next++; i < tasks.size(); i = next++)
+                tasks[i]();
+        };
+
+        vector<thread> workers;
+        for (int t = 1; t < numThreads && static_cast<size_t>(t) < tasks.size(); t++)
+            workers.push_back(thread(worker));
+        worker();
+        for (size_t t = 0; t < workers.size(); t++)
+            workers[t].join();
+    }
+
+        //whether links has the link, either way round
+    bool hasLink(const vector<RoadGraph::Link>& links, const RoadGraph::Link& link) {
+
+        for (size_t i = 0; i < links.size(); i++)
+            if (links[i].m_weight == link.m_weight && ((links[i].m_from == link.m_from && links[i].m_to == link.m_to) ||
+                                                       (links[i].m_from == link.m_to && links[i].m_to == link.m_from)))
+                return true;
+        return false;
+    }
+}
 
 class NavigatorImpl
 {
@@ -15,242 +56,1127 @@ public:
     NavigatorImpl();
     ~NavigatorImpl();
     bool loadMapData(string mapFile);
-    NavResult navigate(string start, string dest, vector<NavSegment>& directions) const;
+    void setBuildThreads(int threads) { m_buildThreads = threads; }
+    NavResult navigate(string start, string dest, vector<NavSegment>& directions, NavStats* stats) const;
+    NavResult navigate(const GeoCoord& start, const GeoCoord& dest, vector<NavSegment>& directions, NavStats* stats) const;
+    vector<string> complete(const string& text, size_t k) const { return m_AttMap.complete(text, k); }
+    void setSearchMode(SearchMode mode);
+    void setQueueKind(QueueKind kind) { m_queue = kind; }
+    void distanceMatrix(const vector<string>& sources, const vector<string>& targets,
+                        vector<vector<double>>& matrix, int numThreads) const;
+    void setRouteCacheCapacity(size_t routes) { m_cache.setCapacity(routes); }
+    RouteCacheStats getRouteCacheStats() const { return m_cache.stats(); }
+    void setTilePrefetch(bool on) { m_prefetcher.setEnabled(on); }
+    void setMaxSnapDistance(double miles) { m_maxSnapMiles = miles; }
+    bool addSegment(const StreetSegment& seg);
+    bool removeSegment(const StreetSegment& seg);
+    bool setSegmentOpen(const StreetSegment& seg, bool open);
+    bool addAttraction(const StreetSegment& seg, const Attraction& att);
+    bool removeAttraction(const string& name);
+    bool isSearchDegraded() const;
     
 private:
-    SegmentMapper m_SegMap;
-    AttractionMapper m_AttMap;
+    typedef RoadGraph::Link Link;
     
-    struct nodeInfo {               //struct containing information about a vertex in the graph
-        
-        nodeInfo(string prevLat, string prevLon, double dist)
-        : m_prevLat(prevLat), m_prevLon(prevLon), m_distFromStart(dist), m_toBeConsidered(true)
-        {}
-        
-        void DoneConsidering() { m_toBeConsidered = false; }
-        
-        string m_prevLat;           // Lat/Lon of node from which this vertex was reached
-        string m_prevLon;
-        double m_distFromStart;
-        bool m_toBeConsidered;
+        //how a segment was taken off the graph
+    struct Closure {
+        bool removed;                   //for good, rather than closed
     };
+    
+    MapLoader* m_loader;                //kept for its name and segment tables; may be backed by a mapped snapshot
+    AttractionMapper m_AttMap;
+    RoadGraph m_graph;
+    SpatialIndex m_grid;                //nearest streets, for routes between coordinates
+    double m_maxSnapMiles;              //how far from its street a coordinate may be
+    int m_buildThreads;                 //threads loadMapData builds the indexes on; 0 for one per core
+    ContractionHierarchy m_hierarchy;   //empty until SEARCH_CONTRACTION is used, unless the snapshot has one
+    Landmarks m_landmarks;              //likewise for SEARCH_LANDMARKS
+    int m_edits;                        //edits made since the map was loaded
+    int m_removals;                     //those of them that took edges off the graph
+    int m_hierarchyEdits;               //m_edits when the hierarchy was built or loaded
+    int m_hierarchyRemovals;            //likewise m_removals
+    int m_views;                        //arrays handed to the prefetcher, at the last feedPrefetcher()
+    DistanceBound m_bound;              //the A* heuristic, fitted to the map's bounding box
+    FixedCoord m_lo, m_hi;              //that box, grown as segments are added
+    MyMap<int, Closure> m_closed;       //segment ID -> its closure, for segments taken off the graph
+    SearchMode m_mode;
+    QueueKind m_queue;
+    mutable RouteCache m_cache;         //thread-safe; filled in by navigate
+    TilePrefetcher m_prefetcher;        //thread-safe; told by the searches' workspaces
 
     /* private member functions */
     
+        //the rest of navigate, once both ends are known
+    NavResult route(const RouteEnd& begin, const RouteEnd& dest, vector<NavSegment>& directions, NavStats* stats) const;
+    
         //returns true if path found, otherwise returns false. If path is found, vec will hold
-        //sequence of geocoordinates in the path. vec is unchanged if there is no path
-    bool pathFinder(GeoCoord& begin, GeoCoord& end, vector<GeoCoord>& vec) const;
-    bool isDestOnStreetSegment(StreetSegment& current, GeoCoord& dest) const;
+        //sequence of node IDs in the path, from one of dest's nodes back to one of begin's,
+        //and edges[i] the ID of the edge joining vec[i] and vec[i+1]. vec and edges are
+        //unchanged if there is no path. ws holds the search state; it is only ever touched
+        //by the calling thread. If useLandmarks is true, the heuristic is sharpened with the
+        //landmark bounds
+    bool pathFinder(const RouteEnd& begin, const RouteEnd& end, vector<int>& vec, vector<int>& edges,
+                    SearchWorkspace& ws, bool useLandmarks) const;
+    
+        //same contract as pathFinder, searching from both ends; fw and bw hold the two searches
+    bool bidirectionalPathFinder(const RouteEnd& begin, const RouteEnd& end, vector<int>& vec, vector<int>& edges,
+                                 SearchWorkspace& fw, SearchWorkspace& bw) const;
+    
+        //same contract again, answered by the contraction hierarchy
+    bool hierarchyPathFinder(const RouteEnd& begin, const RouteEnd& end, vector<int>& vec, vector<int>& edges,
+                             SearchWorkspace& fw, SearchWorkspace& bw) const;
+    
+        //replaces each of edges, which may be IDs from before an edit, with the ID of an edge
+        //joining the same two nodes of vec on the graph as it is now; false if some pair of
+        //them is no longer joined
+    bool relinkEdges(const vector<int>& vec, vector<int>& edges) const;
+    
+        //Dijkstra from source until every node marked in isTarget is settled; row[k] is set to
+        //the distance to targets[k], or -1 if it cannot be reached
+    void oneToMany(int source, const vector<int>& targets, const vector<bool>& isTarget, double row[],
+                   SearchWorkspace& ws) const;
+    
+        //node ID of the named attraction, or -1
+    int attractionNode(const string& name) const;
+    
+        //sets end to the named attraction's node; false if there is no such attraction
+    bool attractionEnd(const string& name, RouteEnd& end) const;
     
-         //great circle distance between two points
-    double heuristic(GeoCoord& current, GeoCoord& end) const;
+        //sets end to the point of the nearest street to gc; false if gc is not a valid
+        //coordinate or the map has no streets
+    bool snappedEnd(const GeoCoord& gc, RouteEnd& end) const;
     
-        //Constructs NavSegment objects for the given path
-    void pathFormatter(vector<GeoCoord>& path, vector<NavSegment>& result) const;
+         //lower bound on the great circle distance between two points of the map
+    double heuristic(const FixedCoord& current, const FixedCoord& end) const;
     
-        //Given two GeoCoord objects, this finds the unique StreetSegment with these endpoints
-    StreetSegment findStreetSegment(GeoCoord& a, GeoCoord& b) const;
+        //A* key of node, less its distance: a lower bound on the rest of the route to dest
+    double estimate(int node, const RouteEnd& dest, bool useLandmarks) const;
+    
+        //ID of the segment with seg's street name and ends, either way round, that has not been
+        //removed; -1 if there is none
+    int findSegment(const StreetSegment& seg) const;
+    
+        //changes the segment's attractions through edit, taking its edges off the graph and
+        //putting them back if it is open; appends the links that went to removed, and the
+        //ones that came to added
+    template<typename Edit>
+    void editAttractions(int segment, Edit edit, vector<Link>& removed, vector<Link>& added);
+    
+        //removeAttraction, short of calling edited
+    bool dropAttraction(const string& name, vector<Link>& removed, vector<Link>& added);
+    
+        //hands the prefetcher the tiles and whichever arrays are still views into a mapped snapshot
+    void feedPrefetcher();
+    
+        //grows the heuristic's box to take in fc
+    void grow(const FixedCoord& fc);
+    
+        //what every edit does last, once: puts the added links into the hierarchy and the
+        //landmarks, and drops the cached routes the links removed or added may have changed
+    void edited(const vector<Link>& removed, const vector<Link>& added);
+    
+        //Constructs NavSegment objects for the given path and its edges, and for the parts of
+        //streets between a snapped end and the path; this is where coordinate text is rebuilt
+    void pathFormatter(const vector<int>& path, const vector<int>& edges, const RouteEnd& begin,
+                       const RouteEnd& dest, vector<NavSegment>& result) const;
     
 };
 
-NavigatorImpl::NavigatorImpl()
+NavigatorImpl::NavigatorImpl() : m_loader(nullptr), m_maxSnapMiles(Navigator::defaultMaxSnapMiles), m_buildThreads(1),
+                                 m_edits(0), m_removals(0), m_hierarchyEdits(0), m_hierarchyRemovals(0), m_views(0),
+                                 m_mode(SEARCH_ASTAR), m_queue(QUEUE_QUATERNARY)
 {
+    m_lo.lat = m_lo.lon = m_hi.lat = m_hi.lon = 0;
 }
 
 NavigatorImpl::~NavigatorImpl()
 {
+    delete m_loader;
 }
 
 bool NavigatorImpl::loadMapData(string mapFile)
 {
-    MapLoader loader;
-    if(!loader.load(mapFile))
+    MapLoader* loader = new MapLoader;      //uses a compiled snapshot instead of the text when one is available
+    if(!loader->load(mapFile)) {
+        delete loader;
         return false;
+    }
+    
+        //the indexes only read the loader's tables, so they can be built at once, at the cost of
+        //holding all their temporaries at once; the hierarchy and the landmarks need the graph,
+        //and are built after it by the same task, which goes first as it takes longest
+    vector<function<void()>> tasks;
+    tasks.push_back([this, loader] {
+        m_graph.build(*loader);
+        m_graph.bounds(m_lo, m_hi);
+        m_bound.init(m_lo, m_hi);
+        if (!m_hierarchy.load(*loader) && m_mode == SEARCH_CONTRACTION)
+            m_hierarchy.build(m_graph);
+        if (!m_landmarks.load(*loader) && m_mode == SEARCH_LANDMARKS)
+            m_landmarks.build(m_graph);
+    });
+    tasks.push_back([this, loader] { m_AttMap.init(*loader); });
+    tasks.push_back([this, loader] { m_grid.build(*loader); });
+    runTasks(tasks, m_buildThreads > 0 ? m_buildThreads : max(1u, thread::hardware_concurrency()));
+    m_closed.clear();
+    m_edits = m_removals = m_hierarchyEdits = m_hierarchyRemovals = 0;
     
-    m_AttMap.init(loader);
-    m_SegMap.init(loader);
+    delete m_loader;                        //the old indexes no longer refer to it
+    m_loader = loader;
+    m_cache.clear();                        //cached routes are in terms of the old node IDs
+    feedPrefetcher();
     
 	return true;
 }
 
-NavResult NavigatorImpl::navigate(string start, string end, vector<NavSegment> &directions) const
+void NavigatorImpl::setSearchMode(SearchMode mode)
+{
+        //a hierarchy kept across removals is rebuilt, so its routes need no checking again
+    if (mode == SEARCH_CONTRACTION && (m_hierarchy.empty() || m_hierarchyRemovals != m_removals) && m_graph.numNodes() > 0) {
+        m_hierarchy.build(m_graph);
+        m_hierarchyEdits = m_edits;
+        m_hierarchyRemovals = m_removals;
+    }
+    if (mode == SEARCH_LANDMARKS && m_landmarks.empty() && m_graph.numNodes() > 0)
+        m_landmarks.build(m_graph);
+    if (mode != m_mode)
+        m_cache.clear();                    //another mode may pick another of several equally short routes
+    m_mode = mode;
+    if (m_loader != nullptr)
+        feedPrefetcher();
+}
+
+bool NavigatorImpl::addSegment(const StreetSegment& seg)
+{
+    vector<GeoCoord> coords(1, seg.segment.start);
+    coords.push_back(seg.segment.end);
+    for (size_t i = 0; i < seg.attractions.size(); i++)
+        coords.push_back(seg.attractions[i].geocoordinates);
+    for (size_t i = 0; i < coords.size(); i++)
+        if (!(fabs(coords[i].latitude) <= 90 && fabs(coords[i].longitude) <= 180))
+            return false;
+    
+    if (m_loader == nullptr)
+        m_loader = new MapLoader;               //an empty map to add to
+    
+    vector<Link> removed, added;
+    for (size_t i = 0; i < seg.attractions.size(); i++)
+        dropAttraction(seg.attractions[i].name, removed, added);    //the new one replaces it
+    
+    MapTables& tables = m_loader->editTables();
+    FixedCoord start = toFixed(seg.segment.start);
+    FixedCoord end = toFixed(seg.segment.end);
+    if (m_graph.numNodes() == 0)
+        m_lo = m_hi = start;                    //the box so far
+    int id = tables.addSegment(tables.intern(seg.streetName), start, end);
+    for (size_t i = 0; i < seg.attractions.size(); i++) {
+        FixedCoord fc = toFixed(seg.attractions[i].geocoordinates);
+        tables.addAttraction(id, tables.intern(seg.attractions[i].name), fc);
+        m_AttMap.addAttraction(seg.attractions[i].name, fc, id);
+        grow(fc);
+    }
+    
+    m_graph.addSegment(tables, id);
+    m_graph.segmentLinks(tables, id, added);
+    m_grid.add(id, start, end);
+    grow(start);
+    grow(end);
+    edited(removed, added);
+    return true;
+}
+
+bool NavigatorImpl::removeSegment(const StreetSegment& seg)
 {
-    GeoCoord begin, dest;
+    int id = findSegment(seg);
+    if (id == -1)
+        return false;
+    
+    const MapTables& tables = m_loader->getTables();
+    const SegmentRecord& rec = tables.segments[id];
+    vector<Link> removed;
+    Closure* closure = m_closed.find(id);
+    if (closure == nullptr) {
+        m_graph.segmentLinks(tables, id, removed);
+        m_graph.removeSegment(tables, id);
+        m_grid.setSnappable(id, rec.start, rec.end, false);
+        Closure gone = { true };
+        m_closed.associate(id, gone);
+    }
+    else
+        closure->removed = true;
+    
+    for (int j = 0; j < rec.numAttractions; j++) {
+        string name = tables.names.get(tables.attractions[rec.firstAttraction + j].name);
+        if (m_AttMap.getSegmentId(name) == id)
+            m_AttMap.removeAttraction(name);
+    }
+    
+    edited(removed, vector<Link>());
+    return true;
+}
+
+bool NavigatorImpl::setSegmentOpen(const StreetSegment& seg, bool open)
+{
+    int id = findSegment(seg);
+    if (id == -1)
+        return false;
+    
+    bool closed = (m_closed.find(id) != nullptr);
+    if (closed != open)
+        return true;                            //already so
+    
+    const MapTables& tables = m_loader->getTables();
+    const SegmentRecord& rec = tables.segments[id];
+    vector<Link> links;
+    m_graph.segmentLinks(tables, id, links);
+    if (open) {
+        m_graph.addSegment(tables, id);
+        m_closed.remove(id);
+    }
+    else {
+        m_graph.removeSegment(tables, id);
+        Closure closure = { false };
+        m_closed.associate(id, closure);
+    }
+    m_grid.setSnappable(id, rec.start, rec.end, open);
+    
+    if (open)
+        edited(vector<Link>(), links);
+    else
+        edited(links, vector<Link>());
+    return true;
+}
+
+bool NavigatorImpl::addAttraction(const StreetSegment& seg, const Attraction& att)
+{
+    const GeoCoord& gc = att.geocoordinates;
+    if (!(fabs(gc.latitude) <= 90 && fabs(gc.longitude) <= 180))
+        return false;
+    
+    int id = findSegment(seg);
+    if (id == -1)
+        return false;
+    
+    vector<Link> removed, added;
+    dropAttraction(att.name, removed, added);   //the new one replaces it
     
-    if(!m_AttMap.getGeoCoord(start, begin))
+    FixedCoord fc = toFixed(gc);
+    editAttractions(id, [&att, &fc](MapTables& tables, int segment) {
+        tables.addAttraction(segment, tables.intern(att.name), fc);
+    }, removed, added);
+    m_AttMap.addAttraction(att.name, fc, id);
+    
+    grow(fc);
+    edited(removed, added);
+    return true;
+}
+
+bool NavigatorImpl::removeAttraction(const string& name)
+{
+    vector<Link> removed, added;
+    if (!dropAttraction(name, removed, added))
+        return false;
+    
+    edited(removed, added);
+    return true;
+}
+
+bool NavigatorImpl::isSearchDegraded() const
+{
+    if (m_mode == SEARCH_CONTRACTION)
+        return m_hierarchy.empty() || m_hierarchyRemovals != m_removals;
+    if (m_mode == SEARCH_LANDMARKS)
+        return m_landmarks.empty();
+    return false;
+}
+
+NavResult NavigatorImpl::navigate(string start, string end, vector<NavSegment> &directions, NavStats* stats) const
+{
+    typedef chrono::steady_clock clock;
+    clock::time_point started;
+    if (stats != nullptr) {
+        *stats = NavStats();
+        stats->hasCounters = (NAV_STATS != 0);
+        started = clock::now();
+    }
+    
+    RouteEnd begin, dest;
+    
+    if(!attractionEnd(start, begin))
         return NAV_BAD_SOURCE;
     
-    if(!m_AttMap.getGeoCoord(end, dest))
+    if(!attractionEnd(end, dest))
         return NAV_BAD_DESTINATION;
     
-    vector<GeoCoord> path;
+    if (stats != nullptr)
+        stats->lookupMs = chrono::duration<double, milli>(clock::now() - started).count();
     
-    if(!pathFinder(begin, dest, path))
-        return NAV_NO_ROUTE;
+    return route(begin, dest, directions, stats);
+}
+
+NavResult NavigatorImpl::navigate(const GeoCoord& start, const GeoCoord& end, vector<NavSegment> &directions,
+                                  NavStats* stats) const
+{
+    typedef chrono::steady_clock clock;
+    clock::time_point started;
+    if (stats != nullptr) {
+        *stats = NavStats();
+        stats->hasCounters = (NAV_STATS != 0);
+        started = clock::now();
+    }
     
-    pathFormatter(path, directions);        //Constructing the NavSegment objects from the path
+    RouteEnd begin, dest;
     
-	return NAV_SUCCESS;
+    if(!snappedEnd(start, begin))
+        return NAV_BAD_SOURCE;
+    
+    if(!snappedEnd(end, dest))
+        return NAV_BAD_DESTINATION;
+    
+    if (stats != nullptr)
+        stats->lookupMs = chrono::duration<double, milli>(clock::now() - started).count();
+    
+    return route(begin, dest, directions, stats);
+}
+
+void NavigatorImpl::distanceMatrix(const vector<string>& sources, const vector<string>& targets,
+                                   vector<vector<double>>& matrix, int numThreads) const
+{
+    matrix.assign(sources.size(), vector<double>(targets.size(), -1));
+    
+        //targets naming the same node share a column of the search results
+    vector<int> targetNodes;
+    vector<int> column(targets.size(), -1);
+    vector<bool> isTarget(m_graph.numNodes(), false);
+    vector<int> columnOf(m_graph.numNodes(), -1);
+    for (size_t j = 0; j < targets.size(); j++) {
+        int node = attractionNode(targets[j]);
+        if (node == -1)
+            continue;
+        if (columnOf[node] == -1) {
+            columnOf[node] = static_cast<int>(targetNodes.size());
+            targetNodes.push_back(node);
+            isTarget[node] = true;
+        }
+        column[j] = columnOf[node];
+    }
+    if (targetNodes.empty())
+        return;
+    
+        //the buckets give lengths only, which a removal since the hierarchy was built may
+        //have made too short
+    bool useHierarchy = (m_mode == SEARCH_CONTRACTION && !m_hierarchy.empty() && m_hierarchyRemovals == m_removals);
+    ContractionHierarchy::TargetBuckets buckets;
+    if (useHierarchy) {
+        SearchWorkspace& ws = SearchWorkspace::forThisThread();
+        ws.setQueue(m_queue);
+        ws.setPrefetcher(&m_prefetcher);
+        m_hierarchy.buildBuckets(targetNodes, buckets, ws);
+    }
+    
+    atomic<size_t> next(0);
+    auto worker = [&]()
+    {
+        SearchWorkspace& ws = SearchWorkspace::forThisThread();
+        ws.setQueue(m_queue);
+        ws.setPrefetcher(&m_prefetcher);
+        vector<double> row(targetNodes.size());
+        for (size_t i = next++; i < sources.size(); i = next++) {
+            
+            int source = attractionNode(sources[i]);
+            if (source == -1)
+                continue;
+            
+            fill(row.begin(), row.end(), -1);
+            if (useHierarchy)
+                m_hierarchy.scanBuckets(source, buckets, row.data(), ws);
+            else
+                oneToMany(source, targetNodes, isTarget, row.data(), ws);
+            
+            for (size_t j = 0; j < targets.size(); j++)
+                if (column[j] != -1)
+                    matrix[i][j] = row[column[j]];
+        }
+    };
+    
+    if (numThreads <= 0)
+        numThreads = max(1u, thread::hardware_concurrency());
+    
+    vector<thread> workers;
+    for (int t = 1; t < numThreads && static_cast<size_t>(t) < sources.size(); t++)
+        workers.push_back(thread(worker));
+    worker();
+    for (size_t t = 0; t < workers.size(); t++)
+        workers[t].join();
 }
 
 /* private member functions */
 
-bool NavigatorImpl::pathFinder(GeoCoord& begin, GeoCoord& dest, vector<GeoCoord> &vec) const {
-    
-    priority_queue<coordPair, vector<coordPair>, greater<coordPair>> pq;    //declaring a minheap
-    MyMap<GeoCoord, nodeInfo> vertices;                                     //holds all encountered vertices
+void NavigatorImpl::oneToMany(int source, const vector<int>& targets, const vector<bool>& isTarget, double row[],
+                              SearchWorkspace& ws) const {
     
-    pq.push(make_pair(heuristic(begin, dest), begin));
-    vertices.associate(begin, nodeInfo("", "", 0));
+    ws.reset(m_graph.numNodes());
+    ws.reach(source, 0, -1);
+    ws.push(0, source);
     
-    while(!pq.empty()) {
-        
-        GeoCoord curr = pq.top().second;            //highest weight vertex
-        nodeInfo* currInfo = vertices.find(curr);
-        pq.pop();
+    size_t remaining = targets.size();
+    while (!ws.heapEmpty() && remaining > 0) {
         
-        if (!currInfo->m_toBeConsidered)            //vertex not to be considered again
+        int curr = ws.pop().second;
+        if (ws.settled(curr))
             continue;
+        ws.settle(curr);
         
-        currInfo->DoneConsidering();
+        if (isTarget[curr])
+            remaining--;
         
-        //Check if destination reached
-        if (curr == dest) {
-            
-            vec.clear();
-            nodeInfo* tempInfo;
-            
-            vec.push_back(curr);
+        for (int e = m_graph.edgeBegin(curr); e < m_graph.edgeEnd(curr); e++) {
             
-            string lat = currInfo->m_prevLat;
-            string lon = currInfo->m_prevLon;
+            int next = m_graph.target(e);
+            double newDist = ws.dist(curr) + m_graph.weight(e);
             
-            while (lat != "" && lon != "") {                  //track predecessors
-                
-                vec.push_back(GeoCoord(lat, lon));
-                tempInfo = vertices.find(GeoCoord(lat, lon));
-                lat = tempInfo->m_prevLat;
-                lon = tempInfo->m_prevLon;
+            if (!ws.reached(next) || ws.dist(next) > newDist) {
+                ws.reach(next, newDist, curr);
+                ws.push(newDist, next);
             }
-            
-            return true;
         }
+    }
+    
+    for (size_t k = 0; k < targets.size(); k++)
+        row[k] = ws.settled(targets[k]) ? ws.dist(targets[k]) : -1;
+}
+
+int NavigatorImpl::attractionNode(const string& name) const {
+    
+    FixedCoord fc;
+    if (!m_AttMap.getGeoCoord(name, fc))
+        return -1;
+    return m_graph.findNode(fc);
+}
+
+bool NavigatorImpl::attractionEnd(const string& name, RouteEnd& end) const {
+    
+    if (!m_AttMap.getGeoCoord(name, end.coord))
+        return false;
+    
+    end.segment = -1;
+    end.numNodes = 1;
+    end.nodes[0] = end.nodes[1] = m_graph.findNode(end.coord);
+    end.dists[0] = end.dists[1] = 0;
+    return true;
+}
+
+bool NavigatorImpl::snappedEnd(const GeoCoord& gc, RouteEnd& end) const {
+    
+    if (!(fabs(gc.latitude) <= 90 && fabs(gc.longitude) <= 180))        //also rejects NaN
+        return false;
+    
+    FixedCoord fc;
+    fc.lat = static_cast<int32_t>(llround(gc.latitude * 1e7));
+    fc.lon = static_cast<int32_t>(llround(gc.longitude * 1e7));
+    
+    SegmentSnap snap;
+    if (!m_grid.nearest(fc, snap) || distanceEarthMiles(fc, snap.point) > m_maxSnapMiles)
+        return false;                                               //no street, or none near enough
+    
+    const SegmentRecord& seg = m_loader->getTables().segments[snap.segment];
+    end.coord = snap.point;
+    end.segment = snap.segment;
+    end.numNodes = 2;
+    end.nodes[0] = m_graph.findNode(seg.start);
+    end.nodes[1] = m_graph.findNode(seg.end);
+    end.dists[0] = distanceEarthMiles(snap.point, seg.start);
+    end.dists[1] = distanceEarthMiles(snap.point, seg.end);
+    return true;
+}
+
+NavResult NavigatorImpl::route(const RouteEnd& begin, const RouteEnd& dest, vector<NavSegment>& directions,
+                               NavStats* stats) const {
+    
+    typedef chrono::steady_clock clock;
+    clock::time_point resolved;
+    if (stats != nullptr)
+        resolved = clock::now();
+    
+    for (int k = 0; k < begin.numNodes; k++)
+        if (begin.nodes[k] == -1)
+            return NAV_NO_ROUTE;
+    for (int k = 0; k < dest.numNodes; k++)
+        if (dest.nodes[k] == -1)
+            return NAV_NO_ROUTE;
+    
+        //only routes between attractions are cached; coordinates hardly ever repeat
+    bool cacheable = (begin.segment == -1 && dest.segment == -1);
+    int source = begin.nodes[0];
+    int target = dest.nodes[0];
+    
+    if (cacheable && m_cache.lookup(source, target, directions)) {
+        if (stats != nullptr) {
+            stats->cacheHit = true;
+            stats->formatMs = chrono::duration<double, milli>(clock::now() - resolved).count();
+        }
+        return NAV_SUCCESS;
+    }
+    
+    SearchWorkspace& ws = SearchWorkspace::forThisThread();
+    SearchWorkspace& ws2 = SearchWorkspace::forThisThread(1);
+    ws.setQueue(m_queue);
+    ws2.setQueue(m_queue);
+    ws.setPrefetcher(&m_prefetcher);
+    ws2.setPrefetcher(&m_prefetcher);
+    ws.setCounting(stats != nullptr);           //the searches only count for a caller who asked
+    ws2.setCounting(stats != nullptr);
+    vector<int>& path = ws.m_path;
+    vector<int>& edges = ws.m_pathEdges;
+    if (stats != nullptr) {
+        ws.m_counters = ws2.m_counters = SearchCounters();
+        ws.m_searchDone = clock::time_point();
+    }
+    
+    bool found;
+    SearchMode searchedWith = m_mode;
+    if (m_mode == SEARCH_CONTRACTION && m_hierarchy.empty())
+        searchedWith = SEARCH_BIDIRECTIONAL;            //the map was empty when the mode was selected
+    else if (m_mode == SEARCH_LANDMARKS && m_landmarks.empty())
+        searchedWith = SEARCH_ASTAR;
+    
+    if (begin.segment != -1 && begin.segment == dest.segment) {
+        path.clear();                                   //straight along the street; nothing is shorter
+        edges.clear();
+        found = true;
+    }
+    else if (searchedWith == SEARCH_CONTRACTION) {
+        found = hierarchyPathFinder(begin, dest, path, edges, ws, ws2);
+        if (found && m_hierarchyEdits != m_edits && !relinkEdges(path, edges)) {
+            searchedWith = SEARCH_BIDIRECTIONAL;        //the route runs over a removal
+            found = bidirectionalPathFinder(begin, dest, path, edges, ws, ws2);
+        }
+    }
+    else if (searchedWith == SEARCH_BIDIRECTIONAL)
+        found = bidirectionalPathFinder(begin, dest, path, edges, ws, ws2);
+    else
+        found = pathFinder(begin, dest, path, edges, ws, searchedWith == SEARCH_LANDMARKS);
+    
+    clock::time_point searched;
+    if (stats != nullptr) {
+        searched = clock::now();
+        stats->searchedWith = searchedWith;
+        clock::time_point searchDone = (found && ws.m_searchDone != clock::time_point()) ? ws.m_searchDone : searched;
+        stats->searchMs = chrono::duration<double, milli>(searchDone - resolved).count();
+        stats->reconstructMs = chrono::duration<double, milli>(searched - searchDone).count();
+        
+        const SearchCounters* sides[2] = { &ws.m_counters, &ws2.m_counters };
+        for (int i = 0; i < 2; i++) {
+            stats->nodesSettled += sides[i]->m_settled;
+            stats->edgesRelaxed += sides[i]->m_relaxed;
+            stats->heapPushes += sides[i]->m_pushes;
+            stats->stalePops += sides[i]->m_stalePops;
+            stats->peakHeapSize += sides[i]->m_peakHeap;
+            stats->nodesTouched += sides[i]->m_touched;
+        }
+        ws.setCounting(false);
+        ws2.setCounting(false);
+    }
+    
+    if(!found)
+        return NAV_NO_ROUTE;
+    
+    pathFormatter(path, edges, begin, dest, directions);    //Constructing the NavSegment objects from the path
+    if (cacheable)
+        m_cache.insert(source, target, directions);
+    
+    if (stats != nullptr)
+        stats->formatMs = chrono::duration<double, milli>(clock::now() - searched).count();
+    
+    return NAV_SUCCESS;
+}
+
+bool NavigatorImpl::pathFinder(const RouteEnd& begin, const RouteEnd& dest, vector<int> &vec, vector<int>& edges,
+                               SearchWorkspace& ws, bool useLandmarks) const {
+    
+    useLandmarks = useLandmarks && !m_landmarks.empty();
+    
+    ws.reset(m_graph.numNodes());                       //nothing has been reached or settled yet
+    
+    for (int k = 0; k < begin.numNodes; k++) {
+        int node = begin.nodes[k];
+        if (!ws.reached(node) || ws.dist(node) > begin.dists[k]) {
+            ws.reach(node, begin.dists[k], -1);
+            ws.push(begin.dists[k] + estimate(node, dest, useLandmarks), node);
+        }
+    }
+    
+    int last = -1;                                      //dest's node on the best route found so far
+    double best = 0;                                    //... and that route's length, to dest itself
+    
+    while(!ws.heapEmpty()) {
         
-        vector<StreetSegment> associates = m_SegMap.getSegments(curr);
+        nodePair top = ws.pop();                        //lowest weight vertex
+        int curr = top.second;
         
-        for (int i = 0; i < associates.size(); i++) {
-            
-            if (isDestOnStreetSegment(associates[i], dest)) {   //destination on this street segment
-                
-                nodeInfo* destInfo = vertices.find(dest);
-                double newDist = currInfo->m_distFromStart + distanceEarthMiles(curr, dest);
-                
-                if (destInfo == nullptr || destInfo->m_distFromStart > newDist) {   //check if new distance is lower
-                    vertices.associate(dest, nodeInfo(curr.latitudeText, curr.longitudeText, newDist));
-                    pq.push(make_pair(newDist, dest));
-                }
+        if (ws.settled(curr)) {                         //vertex not to be considered again
+            ws.noteStalePop();
+            continue;
+        }
+        
+        ws.settle(curr);
+        
+        //Check if destination reached
+        for (int k = 0; k < dest.numNodes; k++) {
+            if (curr == dest.nodes[k] && (last == -1 || ws.dist(curr) + dest.dists[k] < best)) {
+                last = curr;
+                best = ws.dist(curr) + dest.dists[k];
             }
+        }
+        
+            //keys only grow from here on, so nothing else can lead to a shorter route
+        if (last != -1 && top.first >= best)
+            break;
+        
+        for (int e = m_graph.edgeBegin(curr); e < m_graph.edgeEnd(curr); e++) {
             
-            GeoCoord segStart = associates[i].segment.start;
-            nodeInfo* startInfo = vertices.find(segStart);
+            int next = m_graph.target(e);
+            ws.noteRelaxed(1);
+            if (ws.settled(next))
+                continue;
             
-            double newDist = currInfo->m_distFromStart + distanceEarthMiles(curr, segStart);
-            double newWeight = newDist + heuristic(segStart, dest);
+            double newDist = ws.dist(curr) + m_graph.weight(e);
             
                 //check if new distance is lower
-            if (startInfo == nullptr || (startInfo->m_toBeConsidered && startInfo->m_distFromStart > newDist)) {
-                vertices.associate(segStart, nodeInfo(curr.latitudeText, curr.longitudeText, newDist));
-                pq.push(make_pair(newWeight, segStart));
+            if (!ws.reached(next) || ws.dist(next) > newDist) {
+                ws.reach(next, newDist, curr, e);
+                ws.push(newDist + estimate(next, dest, useLandmarks), next);
             }
-           
-            GeoCoord segEnd = associates[i].segment.end;
-            nodeInfo* endInfo = vertices.find(segEnd);
+        }
+        
+    }
+    
+    if (last == -1)
+        return false;
+    
+    ws.noteSearchDone();
+    vec.clear();
+    edges.clear();
+    for (int node = last; node != -1; node = ws.parent(node)) {    //track predecessors
+        vec.push_back(node);
+        if (ws.parent(node) != -1)
+            edges.push_back(ws.parentEdge(node));
+    }
+    
+    return true;
+}
+
+bool NavigatorImpl::bidirectionalPathFinder(const RouteEnd& begin, const RouteEnd& dest, vector<int> &vec,
+                                            vector<int>& edges, SearchWorkspace& fw, SearchWorkspace& bw) const {
+    
+    if (begin.numNodes == 1 && dest.numNodes == 1 && begin.nodes[0] == dest.nodes[0]) {
+        vec.assign(1, begin.nodes[0]);
+        edges.clear();
+        return true;
+    }
+    
+        //Each side runs A* towards the other end with its own great circle heuristic
+        //(the "new bidirectional A*" of Pijls and Post). Once either side's smallest key
+        //reaches the best meeting found so far (best), that side could only go on to
+        //find longer paths, so best is the shortest path.
+    fw.reset(m_graph.numNodes());
+    bw.reset(m_graph.numNodes());
+    
+    for (int k = 0; k < begin.numNodes; k++) {
+        int node = begin.nodes[k];
+        if (!fw.reached(node) || fw.dist(node) > begin.dists[k]) {
+            fw.reach(node, begin.dists[k], -1);
+            fw.push(begin.dists[k] + heuristic(m_graph.coord(node), dest.coord), node);
+        }
+    }
+    for (int k = 0; k < dest.numNodes; k++) {
+        int node = dest.nodes[k];
+        if (!bw.reached(node) || bw.dist(node) > dest.dists[k]) {
+            bw.reach(node, dest.dists[k], -1);
+            bw.push(dest.dists[k] + heuristic(m_graph.coord(node), begin.coord), node);
+        }
+    }
+    
+    double best = -1;                                   //length of the best path found, -1 if none
+    int meeting = -1;                                   //node where that path's two halves join
+    
+        //the ends may share a node, when two points were snapped onto neighbouring segments
+    for (int k = 0; k < dest.numNodes; k++) {
+        int node = dest.nodes[k];
+        if (fw.reached(node) && (best < 0 || fw.dist(node) + bw.dist(node) < best)) {
+            best = fw.dist(node) + bw.dist(node);
+            meeting = node;
+        }
+    }
+    
+    while (!fw.heapEmpty() && !bw.heapEmpty()) {
+        
+        if (best >= 0 && (fw.heapMin() >= best || bw.heapMin() >= best))
+            break;
+        
+            //advance the side with the smaller open list
+        bool forward = fw.heapSize() <= bw.heapSize();
+        SearchWorkspace& ws = forward ? fw : bw;
+        SearchWorkspace& other = forward ? bw : fw;
+        const FixedCoord& goal = forward ? dest.coord : begin.coord;
+        
+        int curr = ws.pop().second;
+        
+        if (ws.settled(curr)) {
+            ws.noteStalePop();
+            continue;
+        }
+        
+        ws.settle(curr);
+        
+            //a node is not expanded if the other side has settled it (paths through it were
+            //counted when it was reached from both ends), or if any path through it must be
+            //at least as long as best, judging by this side's heuristic or the other's keys
+        const FixedCoord& here = m_graph.coord(curr);
+        const FixedCoord& origin = forward ? begin.coord : dest.coord;
+        if (other.settled(curr) || (best >= 0 &&
+            (ws.dist(curr) + heuristic(here, goal) >= best ||
+             (!other.heapEmpty() && ws.dist(curr) + other.heapMin() - heuristic(here, origin) >= best))))
+            continue;
+        
+        ws.noteRelaxed(m_graph.edgeEnd(curr) - m_graph.edgeBegin(curr));
+        for (int e = m_graph.edgeBegin(curr); e < m_graph.edgeEnd(curr); e++) {    //edges run both ways
             
-            newDist = currInfo->m_distFromStart + distanceEarthMiles(curr, segEnd);
-            newWeight = newDist + heuristic(segEnd, dest);
+            int next = m_graph.target(e);
+            if (ws.settled(next))
+                continue;
             
-                //check if new distance is lower
-            if (endInfo == nullptr || (endInfo->m_toBeConsidered && endInfo->m_distFromStart > newDist)) {
-                vertices.associate(segEnd, nodeInfo(curr.latitudeText, curr.longitudeText, newDist));
-                pq.push(make_pair(newWeight, segEnd));
+            double newDist = ws.dist(curr) + m_graph.weight(e);
+            
+            if (!ws.reached(next) || ws.dist(next) > newDist) {
+                ws.reach(next, newDist, curr, e);     //the backward side walks its edges against the route
+                ws.push(newDist + heuristic(m_graph.coord(next), goal), next);
+                
+                if (other.reached(next) && (best < 0 || newDist + other.dist(next) < best)) {
+                    best = newDist + other.dist(next);
+                    meeting = next;
+                }
             }
-   
         }
+    }
+    
+    fw.noteSearchDone();
+    if (meeting == -1)
+        return false;
+    
+        //destination first: from dest back to the meeting node, then on to begin
+    vec.clear();
+    edges.clear();
+    for (int node = meeting; node != -1; node = bw.parent(node)) {
+        vec.push_back(node);
+        if (bw.parent(node) != -1)
+            edges.push_back(bw.parentEdge(node));
+    }
+    reverse(vec.begin(), vec.end());
+    reverse(edges.begin(), edges.end());
+    for (int node = meeting; fw.parent(node) != -1; node = fw.parent(node)) {
+        vec.push_back(fw.parent(node));
+        edges.push_back(fw.parentEdge(node));
+    }
+    
+    return true;
+}
+
+bool NavigatorImpl::hierarchyPathFinder(const RouteEnd& begin, const RouteEnd& dest, vector<int> &vec,
+                                        vector<int>& edges, SearchWorkspace& fw, SearchWorkspace& bw) const {
+    
+    if (m_hierarchy.empty())
+        return false;
+    
+    return m_hierarchy.findPath(begin, dest, vec, edges, fw, bw);
+}
+
+bool NavigatorImpl::relinkEdges(const vector<int>& vec, vector<int>& edges) const {
+    
+    for (size_t i = 0; i < edges.size(); i++) {
+        int from = vec[i+1];
+        int e = edges[i];
+        if (e >= m_graph.edgeBegin(from) && e < m_graph.edgeEnd(from) && m_graph.target(e) == vec[i])
+            continue;                               //the edit left it where it was
         
+            //any edge joining the two will do: an edge's weight is the distance between its ends
+        e = m_graph.edgeBegin(from);
+        while (e < m_graph.edgeEnd(from) && m_graph.target(e) != vec[i])
+            e++;
+        if (e == m_graph.edgeEnd(from))
+            return false;
+        edges[i] = e;
     }
-    return false;
+    return true;
 }
 
-bool NavigatorImpl::isDestOnStreetSegment(StreetSegment &current, GeoCoord &dest) const {
+int NavigatorImpl::findSegment(const StreetSegment& seg) const {
     
-    for (int i = 0; i <current.attractions.size(); i++) {
-        if (current.attractions[i].geocoordinates == dest)
-            return true;
+    if (m_loader == nullptr)
+        return -1;
+    
+    vector<int> found;
+    m_grid.find(toFixed(seg.segment.start), toFixed(seg.segment.end), found);
+    
+    const MapTables& tables = m_loader->getTables();
+    for (size_t i = 0; i < found.size(); i++) {
+        const Closure* closure = m_closed.find(found[i]);
+        if ((closure == nullptr || !closure->removed) && tables.names.compare(tables.segments[found[i]].name, seg.streetName) == 0)
+            return found[i];
     }
+    return -1;
+}
+
+template<typename Edit>
+void NavigatorImpl::editAttractions(int segment, Edit edit, vector<Link>& removed, vector<Link>& added) {
     
-    return false;
+    MapTables& tables = m_loader->editTables();
+    if (m_closed.find(segment) != nullptr) {
+        edit(tables, segment);
+        return;
+    }
+    
+    vector<Link> before, after;
+    m_graph.segmentLinks(tables, segment, before);
+    m_graph.removeSegment(tables, segment);
+    edit(tables, segment);
+    m_graph.addSegment(tables, segment);
+    m_graph.segmentLinks(tables, segment, after);
+    
+    for (size_t i = 0; i < before.size(); i++)
+        if (!hasLink(after, before[i]))
+            removed.push_back(before[i]);
+    for (size_t i = 0; i < after.size(); i++)
+        if (!hasLink(before, after[i]))
+            added.push_back(after[i]);
 }
 
-double NavigatorImpl::heuristic(GeoCoord &current, GeoCoord &end) const {
-    return distanceEarthMiles(current, end);
+bool NavigatorImpl::dropAttraction(const string& name, vector<Link>& removed, vector<Link>& added) {
+    
+    int id = m_AttMap.getSegmentId(name);
+    if (id == -1)
+        return false;
+    
+        //the record of the attraction among its segment's, matched without regard to case
+        //like AttractionMapper matches names
+    const MapTables& tables = m_loader->getTables();
+    const SegmentRecord& rec = tables.segments[id];
+    int index = -1;
+    for (int j = 0; j < rec.numAttractions && index == -1; j++) {
+        int32_t nameId = tables.attractions[rec.firstAttraction + j].name;
+        const char* chars = tables.names.data(nameId);
+        if (tables.names.length(nameId) != name.size())
+            continue;
+        index = j;
+        for (size_t i = 0; i < name.size(); i++)
+            if (tolower(static_cast<unsigned char>(chars[i])) != tolower(static_cast<unsigned char>(name[i])))
+                index = -1;
+    }
+    
+    if (index != -1)
+        editAttractions(id, [index](MapTables& tables, int segment) { tables.removeAttraction(segment, index); },
+                        removed, added);
+    m_AttMap.removeAttraction(name);
+    return true;
 }
 
-void NavigatorImpl::pathFormatter(vector<GeoCoord>& path, vector<NavSegment>& result) const {
+void NavigatorImpl::feedPrefetcher() {
+    
+    m_prefetcher.clear();
+    m_views = m_graph.views() + m_hierarchy.views() + m_landmarks.views();
+    const MapSnapshot* snap = m_loader->getSnapshot();
+    if (snap == nullptr || !snap->isMapped())
+        return;                             //nothing to read ahead; the arrays were parsed or read into memory
+    
+    m_graph.addTo(m_prefetcher);
+    m_hierarchy.addTo(m_prefetcher);
+    m_landmarks.addTo(m_prefetcher);
+}
+
+void NavigatorImpl::grow(const FixedCoord& fc) {
+    
+    if (fc.lat < m_lo.lat || fc.lon < m_lo.lon || fc.lat > m_hi.lat || fc.lon > m_hi.lon) {
+        m_lo.lat = min(m_lo.lat, fc.lat);
+        m_lo.lon = min(m_lo.lon, fc.lon);
+        m_hi.lat = max(m_hi.lat, fc.lat);
+        m_hi.lon = max(m_hi.lon, fc.lon);
+        m_bound.init(m_lo, m_hi);
+        m_cache.clear();                    //the searches go another way, and may pick another of equal routes
+    }
+}
+
+void NavigatorImpl::edited(const vector<Link>& removed, const vector<Link>& added) {
+    
+        //removing edges only lengthens routes, so the landmarks' bounds still hold, and so
+        //does the hierarchy's length of the shortest route: when the route it finds is still
+        //on the graph, it is still the shortest (see relinkEdges). Added edges go into both
+    if (!m_hierarchy.empty() || !m_landmarks.empty()) {
+        SearchWorkspace& ws = SearchWorkspace::forThisThread();
+        SearchWorkspace& ws2 = SearchWorkspace::forThisThread(1);
+        ws.setQueue(m_queue);
+        ws2.setQueue(m_queue);
+        ws.setPrefetcher(&m_prefetcher);
+        ws2.setPrefetcher(&m_prefetcher);
+        if (!m_hierarchy.empty())
+            m_hierarchy.addNodes(m_graph.numNodes());
+        if (!m_landmarks.empty())
+            m_landmarks.addNodes(m_graph.numNodes());
+        for (size_t i = 0; i < added.size(); i++) {
+            if (!m_hierarchy.empty())
+                m_hierarchy.addEdge(m_graph, added[i].m_from, added[i].m_to, added[i].m_weight, ws, ws2);
+            if (!m_landmarks.empty())
+                m_landmarks.addEdge(m_graph, added[i].m_from, added[i].m_to, added[i].m_weight, ws);
+        }
+    }
+    if (!removed.empty())
+        m_removals++;
+    
+        //a cached route is dropped if it ran over a removed link, or if an added link might
+        //shorten it: if even the straight lines to and from the link's ends are shorter
+    m_cache.eraseIf([&](int source, int target, const vector<NavSegment>& directions) {
+        
+        double length = 0;
+        for (size_t i = 0; i < directions.size(); i++) {
+            if (directions[i].m_command != NavSegment::PROCEED)
+                continue;
+            length += directions[i].m_distance;
+            FixedCoord from = toFixed(directions[i].m_geoSegment.start);
+            FixedCoord to = toFixed(directions[i].m_geoSegment.end);
+            for (size_t j = 0; j < removed.size(); j++) {
+                const FixedCoord& a = m_graph.coord(removed[j].m_from);
+                const FixedCoord& b = m_graph.coord(removed[j].m_to);
+                if ((from == a && to == b) || (from == b && to == a))
+                    return true;
+            }
+        }
+        
+        const FixedCoord& s = m_graph.coord(source);
+        const FixedCoord& t = m_graph.coord(target);
+        for (size_t j = 0; j < added.size(); j++) {
+            const FixedCoord& a = m_graph.coord(added[j].m_from);
+            const FixedCoord& b = m_graph.coord(added[j].m_to);
+            double shortest = added[j].m_weight + min(distanceEarthMiles(s, a) + distanceEarthMiles(b, t),
+                                                      distanceEarthMiles(s, b) + distanceEarthMiles(a, t));
+            if (shortest <= length)
+                return true;
+        }
+        return false;
+    });
+    m_edits++;
+    
+    if (m_graph.views() + m_hierarchy.views() + m_landmarks.views() != m_views)
+        feedPrefetcher();                   //the edit copied arrays out of the snapshot
+}
+
+double NavigatorImpl::heuristic(const FixedCoord &current, const FixedCoord &end) const {
+    return m_bound.miles(current, end);         //no trigonometry; see DistanceBound in support.h
+}
+
+double NavigatorImpl::estimate(int node, const RouteEnd& dest, bool useLandmarks) const {
+    
+    double h = heuristic(m_graph.coord(node), dest.coord);
+    if (useLandmarks) {                         //both are lower bounds, so their max is too
+        double viaNodes = m_landmarks.lowerBound(node, dest.nodes[0]) + dest.dists[0];
+        for (int k = 1; k < dest.numNodes; k++)
+            viaNodes = min(viaNodes, m_landmarks.lowerBound(node, dest.nodes[k]) + dest.dists[k]);
+        h = max(h, viaNodes);
+    }
+    return h;
+}
+
+void NavigatorImpl::pathFormatter(const vector<int>& nodes, const vector<int>& edges, const RouteEnd& begin,
+                                  const RouteEnd& dest, vector<NavSegment>& result) const {
+    
+    const MapTables& tables = m_loader->getTables();
     
     result.clear();
-    for (size_t i = path.size()-1; i > 0; i--) {
+    
+    double prevAngle = 0;
+    int prevName = -1;
+    string streetName;
+    
+        //Inserts the PROCEED NavSegment for one stretch of the route, after a TURN if it
+        //changes street. Streets are compared by name ID; the text is only rebuilt when
+        //the street changes
+    auto proceed = [&](const GeoCoord& from, const GeoCoord& to, int name, double angle, double dist) {
         
-        StreetSegment curr = findStreetSegment(path[i], path[i-1]);
-        GeoSegment final;
+        GeoSegment final(from, to);
         
-        final = GeoSegment(path[i], path[i-1]);
+        bool newStreet = (name != prevName);
+        if (newStreet)
+            streetName = tables.names.get(name);
         
-        if (!result.empty() && curr.streetName != result.back().m_streetName) {     //Insert TURN NavSegment
+        if (!result.empty() && newStreet) {                     //Insert TURN NavSegment
             
-            double angle = angleBetween2Lines(result.back().m_geoSegment, final);
-            if (angle < 180)
-                result.push_back(NavSegment("left", curr.streetName));
+            double turn = angle - prevAngle;
+            if (turn < 0)
+                turn += 360;
+            if (turn < 180)
+                result.push_back(NavSegment("left", streetName));
             else
-                result.push_back(NavSegment("right", curr.streetName));
+                result.push_back(NavSegment("right", streetName));
         }
         
-        double dist = distanceEarthMiles(final.start, final.end);     //Insert PROCEED NavSegment
-        double angle = angleOfLine(final);
-        
         if (angle <= 22.5)
-            result.push_back(NavSegment("east", curr.streetName, dist, final));
+            result.push_back(NavSegment("east", streetName, dist, final));
         else if (angle <= 67.5)
-            result.push_back(NavSegment("northeast", curr.streetName, dist, final));
+            result.push_back(NavSegment("northeast", streetName, dist, final));
         else if (angle <= 112.5)
-            result.push_back(NavSegment("north", curr.streetName, dist, final));
+            result.push_back(NavSegment("north", streetName, dist, final));
         else if (angle <= 157.5)
-            result.push_back(NavSegment("northwest", curr.streetName, dist, final));
+            result.push_back(NavSegment("northwest", streetName, dist, final));
         else if (angle <= 202.5)
-            result.push_back(NavSegment("west", curr.streetName, dist, final));
+            result.push_back(NavSegment("west", streetName, dist, final));
         else if (angle <= 247.5)
-            result.push_back(NavSegment("southwest", curr.streetName, dist, final));
+            result.push_back(NavSegment("southwest", streetName, dist, final));
         else if (angle <= 292.5)
-            result.push_back(NavSegment("south", curr.streetName, dist, final));
+            result.push_back(NavSegment("south", streetName, dist, final));
         else if (angle <= 337.5)
-            result.push_back(NavSegment("southeast", curr.streetName, dist, final));
+            result.push_back(NavSegment("southeast", streetName, dist, final));
         else if (angle < 360)
-            result.push_back(NavSegment("east", curr.streetName, dist, final));
-    }
-}
-
-StreetSegment NavigatorImpl::findStreetSegment(GeoCoord &a, GeoCoord &b) const {
+            result.push_back(NavSegment("east", streetName, dist, final));
+        
+        prevAngle = angle;
+        prevName = name;
+    };
     
-    vector<StreetSegment> a_associates = m_SegMap.getSegments(a);
-    vector<StreetSegment> b_associates = m_SegMap.getSegments(b);
+        //a snapped end is joined to the first or last node along part of its segment
+    if (begin.segment != -1) {
+        FixedCoord to = nodes.empty() ? dest.coord : m_graph.coord(nodes.back());
+        double dist = nodes.empty() ? distanceEarthMiles(begin.coord, dest.coord) :
+                      begin.dists[begin.nodes[0] == nodes.back() ? 0 : 1];
+        if (to != begin.coord)
+            proceed(tables.numberTexts.geoCoord(begin.coord), tables.numberTexts.geoCoord(to), tables.segments[begin.segment].name,
+                    angleOfLine(begin.coord, to), dist);
+    }
     
-    for (int i = 0; i < a_associates.size(); i++) {
-        for (int j = 0; j < b_associates.size(); j++) {
+    if (nodes.size() >= 2) {
+        
+        GeoCoord from = tables.numberTexts.geoCoord(m_graph.coord(nodes.back()));
+        for (size_t i = nodes.size()-1; i > 0; i--) {
+            
+            int e = edges[i-1];                                 //joins nodes[i] and nodes[i-1]
+            GeoCoord to = tables.numberTexts.geoCoord(m_graph.coord(nodes[i-1]));
             
-            if (a_associates[i].segment.start == b_associates[j].segment.start && a_associates[i].segment.end == b_associates[j].segment.end)
-                return a_associates[i];
+            double angle = m_graph.bearing(e);
+            if (m_graph.target(e) != nodes[i-1]) {              //edge stored the other way round
+                angle += 180;
+                if (angle >= 360)
+                    angle -= 360;
+            }
+            
+            proceed(from, to, m_graph.streetName(e), angle, m_graph.weight(e));
+            from = to;
         }
     }
-    return StreetSegment();
+    
+    if (dest.segment != -1 && !nodes.empty()) {
+        FixedCoord from = m_graph.coord(nodes.front());
+        double dist = dest.dists[dest.nodes[0] == nodes.front() ? 0 : 1];
+        if (from != dest.coord)
+            proceed(tables.numberTexts.geoCoord(from), tables.numberTexts.geoCoord(dest.coord), tables.segments[dest.segment].name,
+                    angleOfLine(from, dest.coord), dist);
+    }
 }
 
 //******************** Navigator functions ************************************
@@ -275,5 +1201,97 @@ bool Navigator::loadMapData(string mapFile)
 
 NavResult Navigator::navigate(string start, string end, vector<NavSegment>& directions) const
 {
-    return m_impl->navigate(start, end, directions);
+    return m_impl->navigate(start, end, directions, nullptr);
+}
+
+NavResult Navigator::navigate(string start, string end, vector<NavSegment>& directions, NavStats& stats) const
+{
+    return m_impl->navigate(start, end, directions, &stats);
+}
+
+NavResult Navigator::navigate(const GeoCoord& start, const GeoCoord& end, vector<NavSegment>& directions) const
+{
+    return m_impl->navigate(start, end, directions, nullptr);
+}
+
+NavResult Navigator::navigate(const GeoCoord& start, const GeoCoord& end, vector<NavSegment>& directions,
+                              NavStats& stats) const
+{
+    return m_impl->navigate(start, end, directions, &stats);
+}
+
+vector<string> Navigator::complete(const string& text, size_t k) const
+{
+    return m_impl->complete(text, k);
+}
+
+void Navigator::distanceMatrix(const vector<string>& sources, const vector<string>& targets,
+                               vector<vector<double>>& matrix, int numThreads) const
+{
+    m_impl->distanceMatrix(sources, targets, matrix, numThreads);
+}
+
+void Navigator::setRouteCacheCapacity(size_t routes)
+{
+    m_impl->setRouteCacheCapacity(routes);
+}
+
+RouteCacheStats Navigator::getRouteCacheStats() const
+{
+    return m_impl->getRouteCacheStats();
+}
+
+void Navigator::setTilePrefetch(bool on)
+{
+    m_impl->setTilePrefetch(on);
+}
+
+void Navigator::setBuildThreads(int threads)
+{
+    m_impl->setBuildThreads(threads);
+}
+
+void Navigator::setMaxSnapDistance(double miles)
+{
+    m_impl->setMaxSnapDistance(miles);
+}
+
+bool Navigator::addSegment(const StreetSegment& seg)
+{
+    return m_impl->addSegment(seg);
+}
+
+bool Navigator::removeSegment(const StreetSegment& seg)
+{
+    return m_impl->removeSegment(seg);
+}
+
+bool Navigator::setSegmentOpen(const StreetSegment& seg, bool open)
+{
+    return m_impl->setSegmentOpen(seg, open);
+}
+
+bool Navigator::addAttraction(const StreetSegment& seg, const Attraction& att)
+{
+    return m_impl->addAttraction(seg, att);
+}
+
+bool Navigator::removeAttraction(const string& name)
+{
+    return m_impl->removeAttraction(name);
+}
+
+bool Navigator::isSearchDegraded() const
+{
+    return m_impl->isSearchDegraded();
+}
+
+void Navigator::setSearchMode(SearchMode mode)
+{
+    m_impl->setSearchMode(mode);
+}
+
+void Navigator::setQueueKind(QueueKind kind)
+{
+    m_impl->setQueueKind(kind);
 }
\ No newline at end of file
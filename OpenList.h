@@ -0,0 +1,266 @@
+// OpenList.h
+
+#ifndef OPENLIST_INCLUDED
+#define OPENLIST_INCLUDED
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+// Priority queues of node IDs keyed on non-negative doubles, for the open list
+// of a search (see SearchWorkspace). All three have the same interface:
+//
+//      reset(numNodes)     empties the queue for a search over numNodes nodes
+//      empty(), size()
+//      minKey()            the smallest key queued; the queue must not be empty
+//      push(key, node)     queues node with key, or lowers its key if it is queued already
+//      pop()               removes and returns a (key, node) pair with the smallest key
+//
+// BinaryOpenList is a binary heap that does not look for a node already in it;
+// lowering a key queues the node a second time, and the caller skips the stale
+// entry when it is popped. QuaternaryOpenList is a 4-ary heap that remembers
+// where each node is, so lowering a key moves the node in place and nothing is
+// ever popped twice. RadixOpenList buckets the keys by the highest bit in
+// which they differ from the last key popped; it needs the keys to be
+// monotone (nothing pushed below the last key popped), which holds for
+// Dijkstra and for A* with a consistent heuristic. A key that falls below the
+// last one popped through rounding is queued as if it equalled it.
+
+typedef std::pair<double, int> nodePair;    //(key, node ID) entry of the open list
+
+class BinaryOpenList
+{
+public:
+    void reset(int) { m_heap.clear(); }
+    bool empty() const { return m_heap.empty(); }
+    std::size_t size() const { return m_heap.size(); }
+    double minKey() { return m_heap.front().first; }
+    void push(double key, int node);
+    nodePair pop();
+
+private:
+    std::vector<nodePair> m_heap;
+};
+
+class QuaternaryOpenList
+{
+public:
+    void reset(int numNodes);
+    bool empty() const { return m_heap.empty(); }
+    std::size_t size() const { return m_heap.size(); }
+    double minKey() { return m_heap.front().first; }
+    void push(double key, int node);
+    nodePair pop();
+
+private:
+    std::vector<nodePair> m_heap;
+    std::vector<int> m_position;            // index of each node in m_heap, -1 if it is not queued
+
+    /* private member functions */
+    void siftUp(std::size_t i);
+    void siftDown(std::size_t i);
+    void place(std::size_t i, const nodePair& entry) { m_heap[i] = entry; m_position[entry.second] = static_cast<int>(i); }
+};
+
+class RadixOpenList
+{
+public:
+    RadixOpenList() : m_last(0), m_size(0) {}
+    void reset(int);
+    bool empty() const { return m_size == 0; }
+    std::size_t size() const { return m_size; }
+    double minKey();
+    void push(double key, int node);
+    nodePair pop();
+
+private:
+    struct Entry {
+        uint64_t m_bits;                    // the key's bit pattern, which orders non-negative doubles
+        double m_key;
+        int m_node;
+    };
+
+    static const int numBuckets = 65;       // bucket 0 holds keys equal to m_last, bucket b keys whose
+                                            // highest bit differing from m_last is bit b-1
+    std::vector<Entry> m_buckets[numBuckets];
+    uint64_t m_last;                        // bits of the last key popped
+    std::size_t m_size;
+
+    /* private member functions */
+    static uint64_t bitsOf(double key) { uint64_t bits; std::memcpy(&bits, &key, sizeof bits); return bits; }
+    static int bucketOf(uint64_t bits, uint64_t last);
+    void refill();                          //makes bucket 0 non-empty, if the queue is
+};
+
+//******************** BinaryOpenList functions *******************************
+
+inline void BinaryOpenList::push(double key, int node)
+{
+    m_heap.push_back(std::make_pair(key, node));
+    std::push_heap(m_heap.begin(), m_heap.end(), std::greater<nodePair>());
+}
+
+inline nodePair BinaryOpenList::pop()
+{
+    std::pop_heap(m_heap.begin(), m_heap.end(), std::greater<nodePair>());
+    nodePair top = m_heap.back();
+    m_heap.pop_back();
+    return top;
+}
+
+//******************** QuaternaryOpenList functions ***************************
+
+inline void QuaternaryOpenList::reset(int numNodes)
+{
+    for (std::size_t i = 0; i < m_heap.size(); i++)     //only what the last search left behind
+        m_position[m_heap[i].second] = -1;
+    m_heap.clear();
+
+    if (m_position.size() < static_cast<std::size_t>(numNodes))
+        m_position.resize(numNodes, -1);
+}
+
+inline void QuaternaryOpenList::push(double key, int node)
+{
+    int at = m_position[node];
+    if (at == -1) {
+        m_heap.push_back(nodePair());
+        place(m_heap.size() - 1, std::make_pair(key, node));
+        siftUp(m_heap.size() - 1);
+    }
+    else if (key < m_heap[at].first) {
+        m_heap[at].first = key;
+        siftUp(at);
+    }
+}
+
+inline nodePair QuaternaryOpenList::pop()
+{
+    nodePair top = m_heap.front();
+    m_position[top.second] = -1;
+
+    nodePair last = m_heap.back();
+    m_heap.pop_back();
+    if (!m_heap.empty()) {
+        place(0, last);
+        siftDown(0);
+    }
+    return top;
+}
+
+inline void QuaternaryOpenList::siftUp(std::size_t i)
+{
+    nodePair entry = m_heap[i];
+    while (i > 0) {
+        std::size_t parent = (i - 1) / 4;
+        if (!(entry < m_heap[parent]))
+            break;
+        place(i, m_heap[parent]);
+        i = parent;
+    }
+    place(i, entry);
+}
+
+inline void QuaternaryOpenList::siftDown(std::size_t i)
+{
+    nodePair entry = m_heap[i];
+    std::size_t n = m_heap.size();
+    for (;;) {
+        std::size_t first = 4 * i + 1;
+        if (first >= n)
+            break;
+        std::size_t best = first;
+        std::size_t last = std::min(first + 4, n);
+        for (std::size_t c = first + 1; c < last; c++)
+            if (m_heap[c] < m_heap[best])
+                best = c;
+        if (!(m_heap[best] < entry))
+            break;
+        place(i, m_heap[best]);
+        i = best;
+    }
+    place(i, entry);
+}
+
+//******************** RadixOpenList functions ********************************
+
+inline void RadixOpenList::reset(int)
+{
+    for (int b = 0; b < numBuckets; b++)
+        m_buckets[b].clear();
+    m_last = 0;
+    m_size = 0;
+}
+
+inline int RadixOpenList::bucketOf(uint64_t bits, uint64_t last)
+{
+    uint64_t diff = bits ^ last;
+    if (diff == 0)
+        return 0;
+#if defined(__GNUC__)
+    return 64 - __builtin_clzll(diff);
+#else
+    int b = 0;
+    while (diff != 0) {
+        diff >>= 1;
+        b++;
+    }
+    return b;
+#endif
+}
+
+inline void RadixOpenList::push(double key, int node)
+{
+    uint64_t bits = bitsOf(key);
+    if (bits < m_last)                      //rounding put it below the last key popped
+        bits = m_last;
+
+    Entry e = { bits, key, node };
+    m_buckets[bucketOf(bits, m_last)].push_back(e);
+    m_size++;
+}
+
+inline void RadixOpenList::refill()
+{
+    if (!m_buckets[0].empty() || m_size == 0)
+        return;
+
+        //the lowest non-empty bucket holds the smallest keys; its minimum becomes m_last,
+        //and every entry in it then lands in a lower bucket
+    int b = 1;
+    while (m_buckets[b].empty())
+        b++;
+
+    std::vector<Entry>& from = m_buckets[b];
+    uint64_t least = from[0].m_bits;
+    for (std::size_t i = 1; i < from.size(); i++)
+        least = std::min(least, from[i].m_bits);
+
+    m_last = least;
+    for (std::size_t i = 0; i < from.size(); i++)
+        m_buckets[bucketOf(from[i].m_bits, m_last)].push_back(from[i]);
+    from.clear();
+}
+
+inline double RadixOpenList::minKey()
+{
+    refill();
+    double key;
+    std::memcpy(&key, &m_last, sizeof key);
+    return key;
+}
+
+inline nodePair RadixOpenList::pop()
+{
+    refill();
+    Entry e = m_buckets[0].back();
+    m_buckets[0].pop_back();
+    m_size--;
+    return std::make_pair(e.m_key, e.m_node);
+}
+
+#endif // OPENLIST_INCLUDED
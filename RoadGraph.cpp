@@ -0,0 +1,382 @@
+#include "RoadGraph.h"
+#include "MapSnapshot.h"
+#include "TilePrefetcher.h"
+#include "provided.h"
+#include "support.h"
+#include "MyMap.h"
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+using namespace std;
+
+namespace {
+
+    struct rawEdge {                //edge collected before the CSR arrays are laid out
+        int m_from;
+        int m_to;
+        double m_weight;
+        int m_name;
+    };
+
+    void addBothWays(vector<rawEdge>& edges, int a, int b, double weight, int name) {
+
+        rawEdge e1 = { a, b, weight, name };
+        rawEdge e2 = { b, a, weight, name };
+        edges.push_back(e1);
+        edges.push_back(e2);
+    }
+
+    bool coordLess(const FixedCoord& a, const FixedCoord& b) {
+        return a.lat < b.lat || (a.lat == b.lat && a.lon < b.lon);
+    }
+
+        //calls join(a, b, miles, name) for each pair of nodes segment joins, which are its two
+        //ends and its attractions (each joined to both ends and to each other), finding each
+        //node with nodeOf(fc). Pairs that are one node are skipped
+    template<typename NodeOf, typename Join>
+    void forEachSegmentEdge(const MapTables& tables, size_t segment, NodeOf nodeOf, Join join) {
+
+        const SegmentRecord& seg = tables.segments[segment];
+
+        int start = nodeOf(seg.start);
+        int end = nodeOf(seg.end);
+
+        if (start != end)
+            join(start, end, distanceEarthMiles(seg.start, seg.end), seg.name);
+
+            //attractions connect to both ends of their segment and to each other,
+            //which is what SegmentMapper's attraction entries allowed the search to do
+        vector<pair<int, FixedCoord>> attractions;
+        for (int j = 0; j < seg.numAttractions; j++) {
+
+            const FixedCoord& fc = tables.attractions[seg.firstAttraction + j].coord;
+            int a = nodeOf(fc);
+
+            if (a != start)
+                join(a, start, distanceEarthMiles(fc, seg.start), seg.name);
+            if (a != end)
+                join(a, end, distanceEarthMiles(fc, seg.end), seg.name);
+
+            for (size_t k = 0; k < attractions.size(); k++)
+                if (a != attractions[k].first)
+                    join(a, attractions[k].first, distanceEarthMiles(fc, attractions[k].second), seg.name);
+
+            attractions.push_back(make_pair(a, fc));
+        }
+    }
+
+        //column or row of the tile holding v, which is offset from the tiles' origin
+    int tileIndex(int64_t v, int32_t side, int32_t count) {
+        return static_cast<int>(min<int64_t>(count - 1, max<int64_t>(0, v / side)));
+    }
+
+        //finds or creates the node at fc
+    int nodeFor(const FixedCoord& fc, MyMap<FixedCoord, int>& ids, vector<FixedCoord>& coords) {
+
+        const int* id = ids.find(fc);
+        if (id != nullptr)
+            return *id;
+
+        int node = static_cast<int>(coords.size());
+        ids.associate(fc, node);
+        coords.push_back(fc);
+        return node;
+    }
+}
+
+RoadGraph::RoadGraph() : m_first(nullptr), m_last(nullptr), m_numSorted(0)
+{
+}
+
+RoadGraph::~RoadGraph()
+{
+}
+
+void RoadGraph::clear()
+{
+    m_coords.clear();
+    m_offsets.clear();
+    m_targets.clear();
+    m_weights.clear();
+    m_names.clear();
+    m_bearings.clear();
+    m_tileShape.clear();
+    m_tileNodes.clear();
+    m_begins.clear();
+    m_ends.clear();
+    m_limits.clear();
+    m_addedNodes.clear();
+    useOffsets();
+}
+
+void RoadGraph::build(const MapLoader& ml)
+{
+    clear();
+
+    const MapSnapshot* snap = ml.getSnapshot();
+    if (snap != nullptr && snap->get(SNAP_GRAPH_COORDS, m_coords) && snap->get(SNAP_GRAPH_OFFSETS, m_offsets) &&
+        snap->get(SNAP_GRAPH_TARGETS, m_targets) && snap->get(SNAP_GRAPH_WEIGHTS, m_weights) &&
+        snap->get(SNAP_GRAPH_NAMES, m_names) && snap->get(SNAP_GRAPH_BEARINGS, m_bearings) &&
+        snap->get(SNAP_GRAPH_TILE_SHAPE, m_tileShape) && snap->get(SNAP_GRAPH_TILE_NODES, m_tileNodes) &&
+        m_tileShape.size() == 1) {
+        useOffsets();
+        return;                                 //graph was compiled into the snapshot
+    }
+
+    clear();
+
+    const MapTables& tables = ml.getTables();
+    MyMap<FixedCoord, int> ids;
+    vector<FixedCoord> coords;                  //in order of first appearance
+    vector<rawEdge> edges;
+
+    for (size_t i = 0; i < tables.segments.size(); i++)
+        forEachSegmentEdge(tables, i, [&](const FixedCoord& fc) { return nodeFor(fc, ids, coords); },
+                           [&edges](int a, int b, double miles, int name) { addBothWays(edges, a, b, miles, name); });
+
+        //square tiles of about nodesPerTile nodes over the nodes' bounding box
+    int n = static_cast<int>(coords.size());
+    TileShape shape = { FixedCoord(), 1, 1, 1 };
+    if (n > 0) {
+        FixedCoord lo = coords[0], hi = coords[0];
+        for (int i = 1; i < n; i++) {
+            lo.lat = min(lo.lat, coords[i].lat);
+            lo.lon = min(lo.lon, coords[i].lon);
+            hi.lat = max(hi.lat, coords[i].lat);
+            hi.lon = max(hi.lon, coords[i].lon);
+        }
+        double width = max(1.0, static_cast<double>(hi.lon) - lo.lon);
+        double height = max(1.0, static_cast<double>(hi.lat) - lo.lat);
+        shape.m_origin = lo;
+        shape.m_side = static_cast<int32_t>(min(2e9, max(1.0, ceil(sqrt(width * height * nodesPerTile / n)))));
+        shape.m_cols = static_cast<int32_t>(width / shape.m_side) + 1;
+        shape.m_rows = static_cast<int32_t>(height / shape.m_side) + 1;
+    }
+    vector<TileShape> shapes(1, shape);
+    m_tileShape.adopt(shapes);
+
+        //renumber the nodes tile by tile, in coordinate order within a tile
+    vector<int> tile(n);
+    vector<int32_t> tileNodes(static_cast<size_t>(shape.m_cols) * shape.m_rows + 1, 0);
+    vector<int> order(n);
+    for (int i = 0; i < n; i++) {
+        order[i] = i;
+        tile[i] = tileOf(coords[i]);
+        tileNodes[tile[i] + 1]++;
+    }
+    for (size_t t = 1; t < tileNodes.size(); t++)
+        tileNodes[t] += tileNodes[t - 1];
+    sort(order.begin(), order.end(), [&coords, &tile](int a, int b) {
+        return tile[a] != tile[b] ? tile[a] < tile[b] : coordLess(coords[a], coords[b]);
+    });
+
+    vector<int> newId(n);
+    vector<FixedCoord> sorted(n);
+    for (int i = 0; i < n; i++) {
+        newId[order[i]] = i;
+        sorted[i] = coords[order[i]];
+    }
+
+        //counting sort of the edges by source node
+    vector<int32_t> offsets(n + 1, 0);
+    for (size_t i = 0; i < edges.size(); i++)
+        offsets[newId[edges[i].m_from] + 1]++;
+    for (int i = 0; i < n; i++)
+        offsets[i + 1] += offsets[i];
+
+    vector<int32_t> targets(edges.size());
+    vector<double> weights(edges.size());
+    vector<int32_t> names(edges.size());
+    vector<double> bearings(edges.size());
+
+    vector<int32_t> next(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < edges.size(); i++) {
+        int slot = next[newId[edges[i].m_from]]++;
+        targets[slot] = newId[edges[i].m_to];
+        weights[slot] = edges[i].m_weight;
+        names[slot] = edges[i].m_name;
+        bearings[slot] = angleOfLine(coords[edges[i].m_from], coords[edges[i].m_to]);
+    }
+
+    m_coords.adopt(sorted);
+    m_offsets.adopt(offsets);
+    m_targets.adopt(targets);
+    m_weights.adopt(weights);
+    m_names.adopt(names);
+    m_bearings.adopt(bearings);
+    m_tileNodes.adopt(tileNodes);
+    useOffsets();
+}
+
+void RoadGraph::save(SnapshotWriter& w) const
+{
+    w.add(SNAP_GRAPH_COORDS, m_coords);
+    w.add(SNAP_GRAPH_OFFSETS, m_offsets);
+    w.add(SNAP_GRAPH_TARGETS, m_targets);
+    w.add(SNAP_GRAPH_WEIGHTS, m_weights);
+    w.add(SNAP_GRAPH_NAMES, m_names);
+    w.add(SNAP_GRAPH_BEARINGS, m_bearings);
+    w.add(SNAP_GRAPH_TILE_SHAPE, m_tileShape);
+    w.add(SNAP_GRAPH_TILE_NODES, m_tileNodes);
+}
+
+void RoadGraph::addTo(TilePrefetcher& prefetcher) const
+{
+    prefetcher.setTiles(m_tileNodes);
+    prefetcher.addNodeArray(m_coords);
+    prefetcher.addNodeArray(m_offsets);
+    prefetcher.addEdgeArray(m_targets, m_offsets);
+    prefetcher.addEdgeArray(m_weights, m_offsets);
+    prefetcher.addEdgeArray(m_names, m_offsets);
+    prefetcher.addEdgeArray(m_bearings, m_offsets);
+}
+
+int RoadGraph::views() const
+{
+    return m_coords.isView() + m_offsets.isView() + m_targets.isView() + m_weights.isView() + m_names.isView() +
+           m_bearings.isView() + m_tileNodes.isView();
+}
+
+void RoadGraph::addSegment(const MapTables& tables, int segment)
+{
+    prepareEdits();
+    forEachSegmentEdge(tables, segment, [this](const FixedCoord& fc) { return nodeAt(fc); },
+                       [this](int a, int b, double miles, int name) { addEdge(a, b, miles, name); addEdge(b, a, miles, name); });
+}
+
+void RoadGraph::removeSegment(const MapTables& tables, int segment)
+{
+    prepareEdits();
+    forEachSegmentEdge(tables, segment, [this](const FixedCoord& fc) { return findNode(fc); },
+                       [this](int a, int b, double miles, int name) { removeEdge(a, b, miles, name); removeEdge(b, a, miles, name); });
+}
+
+void RoadGraph::segmentLinks(const MapTables& tables, int segment, vector<Link>& links) const
+{
+    forEachSegmentEdge(tables, segment, [this](const FixedCoord& fc) { return findNode(fc); },
+                       [&links](int a, int b, double miles, int) { links.push_back(Link{ a, b, miles }); });
+}
+
+void RoadGraph::bounds(FixedCoord& lo, FixedCoord& hi) const
+{
+    lo.lat = lo.lon = hi.lat = hi.lon = 0;
+    if (m_coords.empty())
+        return;
+
+    lo = hi = m_coords[0];
+    for (size_t i = 1; i < m_coords.size(); i++) {
+        lo.lat = min(lo.lat, m_coords[i].lat);
+        lo.lon = min(lo.lon, m_coords[i].lon);
+        hi.lat = max(hi.lat, m_coords[i].lat);
+        hi.lon = max(hi.lon, m_coords[i].lon);
+    }
+}
+
+int RoadGraph::findNode(const FixedCoord& fc) const
+{
+    if (m_numSorted > 0) {
+        int t = tileOf(fc);
+        const FixedCoord* last = m_coords.begin() + m_tileNodes[t + 1];
+        const FixedCoord* it = lower_bound(m_coords.begin() + m_tileNodes[t], last, fc, coordLess);
+        if (it != last && *it == fc)
+            return static_cast<int>(it - m_coords.begin());
+    }
+
+    const int* added = m_addedNodes.find(fc);
+    return added != nullptr ? *added : -1;
+}
+
+/* private member functions */
+
+int RoadGraph::tileOf(const FixedCoord& fc) const
+{
+    const TileShape& shape = m_tileShape[0];
+    return tileIndex(static_cast<int64_t>(fc.lat) - shape.m_origin.lat, shape.m_side, shape.m_rows) * shape.m_cols +
+           tileIndex(static_cast<int64_t>(fc.lon) - shape.m_origin.lon, shape.m_side, shape.m_cols);
+}
+
+void RoadGraph::useOffsets()
+{
+    m_first = m_offsets.data();
+    m_last = m_offsets.empty() ? nullptr : m_offsets.data() + 1;
+    m_numSorted = static_cast<int>(m_coords.size());
+}
+
+void RoadGraph::prepareEdits()
+{
+    if (m_last == m_ends.data() && m_last != nullptr)
+        return;                                     //edited already
+
+    m_begins.clear();
+    m_ends.clear();
+    if (!m_offsets.empty()) {
+        m_begins.assign(m_offsets.begin(), m_offsets.end() - 1);
+        m_ends.assign(m_offsets.begin() + 1, m_offsets.end());
+    }
+    m_limits = m_ends;
+    m_first = m_begins.data();
+    m_last = m_ends.data();
+}
+
+int RoadGraph::nodeAt(const FixedCoord& fc)
+{
+    int node = findNode(fc);
+    if (node != -1)
+        return node;
+
+    node = numNodes();
+    m_coords.push_back(fc);
+    m_addedNodes.associate(fc, node);
+
+    int32_t end = static_cast<int32_t>(m_targets.size());
+    m_begins.push_back(end);
+    m_ends.push_back(end);
+    m_limits.push_back(end);
+    m_first = m_begins.data();
+    m_last = m_ends.data();
+    return node;
+}
+
+void RoadGraph::addEdge(int from, int to, double weight, int name)
+{
+    if (m_ends[from] == m_limits[from]) {           //no free slot: move the run to the end, doubled
+        int32_t begin = m_begins[from];
+        int32_t count = m_ends[from] - begin;
+        int32_t moved = static_cast<int32_t>(m_targets.size());
+        for (int32_t i = 0; i < max(count, 2) * 2; i++) {
+            bool used = i < count;
+            m_targets.push_back(used ? m_targets[begin + i] : from);
+            m_weights.push_back(used ? m_weights[begin + i] : 0);
+            m_names.push_back(used ? m_names[begin + i] : -1);
+            m_bearings.push_back(used ? m_bearings[begin + i] : 0);
+        }
+        m_begins[from] = moved;
+        m_ends[from] = moved + count;
+        m_limits[from] = static_cast<int32_t>(m_targets.size());
+    }
+
+    int e = m_ends[from]++;
+    m_targets.edit(e) = to;
+    m_weights.edit(e) = weight;
+    m_names.edit(e) = name;
+    m_bearings.edit(e) = angleOfLine(m_coords[from], m_coords[to]);
+}
+
+void RoadGraph::removeEdge(int from, int to, double weight, int name)
+{
+    if (from == -1 || to == -1)
+        return;
+
+    for (int e = m_begins[from]; e < m_ends[from]; e++) {
+        if (m_targets[e] != to || m_weights[e] != weight || m_names[e] != name)
+            continue;
+
+        int last = --m_ends[from];                  //the last edge of the run takes its place
+        m_targets.edit(e) = m_targets[last];
+        m_weights.edit(e) = m_weights[last];
+        m_names.edit(e) = m_names[last];
+        m_bearings.edit(e) = m_bearings[last];
+        return;
+    }
+}
@@ -0,0 +1,128 @@
+// RoadGraph.h
+
+#ifndef ROADGRAPH_INCLUDED
+#define ROADGRAPH_INCLUDED
+
+#include "provided.h"
+#include "support.h"
+#include "MyMap.h"
+#include <string>
+#include <vector>
+
+// A dense, read-only view of the street network used by the search.
+// Every segment endpoint and every attraction becomes a node with an integer ID,
+// and the adjacency is stored in CSR form: the edges leaving node n are
+// m_targets[m_offsets[n]] .. m_targets[m_offsets[n+1]-1], with their lengths
+// (in miles), street name IDs and bearings stored at the same indices. Each
+// segment is stored once in each direction, so an edge ID also says which
+// way a route crosses it.
+//
+// The map is cut into square tiles of about nodesPerTile nodes each (cells of
+// a latitude/longitude grid), and node IDs are assigned tile by tile, in
+// (latitude, longitude) order within a tile. A coordinate is found by working
+// out its tile and binary searching the tile's nodes, and each tile's nodes
+// and edges are one run of every array, so a search that stays in a few
+// tiles only reads those parts of a snapshot (see TilePrefetcher.h). The whole
+// graph is a handful of flat arrays that can be saved to and used in place
+// from a snapshot.
+//
+// The graph can also be edited in place, a segment at a time. The first edit
+// gives every node a separate begin and end into the edge arrays: a removed
+// edge is swapped to the end of its node's run and dropped from it, leaving a
+// free slot, and an edge added to a node with no free slot moves the node's
+// run to the end of the arrays with room to spare. Nodes are added at the end
+// and found through a small map. Edge IDs of an edited node may change, node
+// IDs never do. save writes the graph as built, without the edits.
+
+class TilePrefetcher;
+
+class RoadGraph
+{
+public:
+    static const int nodesPerTile = 1024;   // on average, over the map's bounding box
+
+    RoadGraph();
+    ~RoadGraph();
+    void build(const MapLoader& ml);        // uses the snapshot's copy if ml was loaded from one
+    void clear();
+    void save(SnapshotWriter& w) const;
+
+        //adds the edges build makes for the segment, creating any node they need
+    void addSegment(const MapTables& tables, int segment);
+        //removes them again; the nodes stay
+    void removeSegment(const MapTables& tables, int segment);
+
+        //two nodes an edge joins both ways, and its length
+    struct Link {
+        int m_from;
+        int m_to;
+        double m_weight;
+    };
+        //appends to links the pairs of nodes addSegment joins for the segment, all of which
+        //must be on the graph already
+    void segmentLinks(const MapTables& tables, int segment, std::vector<Link>& links) const;
+
+    int numNodes() const { return static_cast<int>(m_coords.size()); }
+    int numEdges() const { return static_cast<int>(m_targets.size()); }
+
+        //returns the ID of the node at fc, or -1 if there is none
+    int findNode(const FixedCoord& fc) const;
+    const FixedCoord& coord(int node) const { return m_coords[node]; }
+        //smallest box holding every node: lo has the least latitude and longitude, hi the greatest
+    void bounds(FixedCoord& lo, FixedCoord& hi) const;
+
+        //edges leaving node are the IDs in [edgeBegin(node), edgeEnd(node))
+    int edgeBegin(int node) const { return m_first[node]; }
+    int edgeEnd(int node) const { return m_last[node]; }
+    int target(int edge) const { return m_targets[edge]; }
+    double weight(int edge) const { return m_weights[edge]; }
+    int streetName(int edge) const { return m_names[edge]; }    // ID in the MapLoader's name table
+    double bearing(int edge) const { return m_bearings[edge]; } // angleOfLine from the edge's source to its target
+
+        //hands prefetcher the tiles and the arrays indexed by node or edge
+    void addTo(TilePrefetcher& prefetcher) const;
+        //how many of the arrays addTo hands over are views into a snapshot
+    int views() const;
+
+      // We prevent a RoadGraph object from being copied or assigned.
+    RoadGraph(const RoadGraph&) = delete;
+    RoadGraph& operator=(const RoadGraph&) = delete;
+
+private:
+    struct TileShape {
+        FixedCoord  m_origin;               // least latitude and longitude of any node
+        int32_t     m_side;                 // in FixedCoord units
+        int32_t     m_cols;
+        int32_t     m_rows;
+    };
+
+    FlatArray<FixedCoord> m_coords;         // node ID -> coordinate, sorted tile by tile
+    FlatArray<TileShape> m_tileShape;       // one record
+    FlatArray<int32_t> m_tileNodes;         // nodes of tile t = row * cols + col are [m_tileNodes[t], m_tileNodes[t+1])
+
+    FlatArray<int32_t> m_offsets;           // CSR row offsets, numNodes()+1 entries
+    FlatArray<int32_t> m_targets;
+    FlatArray<double> m_weights;
+    FlatArray<int32_t> m_names;
+    FlatArray<double> m_bearings;
+
+        //the edges of node are [m_first[node], m_last[node]): m_offsets and m_offsets+1 as
+        //built, or m_begins and m_ends once the graph has been edited
+    const int32_t* m_first;
+    const int32_t* m_last;
+    std::vector<int32_t> m_begins;
+    std::vector<int32_t> m_ends;
+    std::vector<int32_t> m_limits;          // end of the slots node's run may grow into
+    int m_numSorted;                        // nodes [0, m_numSorted) are in tile order
+    MyMap<FixedCoord, int> m_addedNodes;    // coordinate -> ID of the nodes added since
+
+    /* private member functions */
+    int tileOf(const FixedCoord& fc) const;
+    void useOffsets();
+    void prepareEdits();
+    int nodeAt(const FixedCoord& fc);       //finds or adds the node at fc
+    void addEdge(int from, int to, double weight, int name);
+    void removeEdge(int from, int to, double weight, int name);
+};
+
+#endif // ROADGRAPH_INCLUDED
@@ -0,0 +1,190 @@
+#include "RouteCache.h"
+#include "provided.h"
+#include "MyMap.h"
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+using namespace std;
+
+RouteCache::RouteCache() : m_capacity(0), m_head(-1), m_tail(-1)
+{
+    m_stats.hits = m_stats.misses = m_stats.evictions = 0;
+    m_stats.size = m_stats.capacity = 0;
+}
+
+RouteCache::~RouteCache()
+{
+}
+
+void RouteCache::setCapacity(size_t routes)
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    m_capacity = routes;
+    while (m_entries.size() > m_capacity)
+        evictTail();
+}
+
+bool RouteCache::lookup(int source, int target, vector<NavSegment>& directions)
+{
+    Route route;
+    {
+        lock_guard<mutex> lock(m_mutex);
+
+        if (m_capacity == 0)
+            return false;
+
+        const int* entry = m_index.find(keyOf(source, target));
+        if (entry == nullptr) {
+            m_stats.misses++;
+            return false;
+        }
+
+        m_stats.hits++;
+        int e = *entry;
+        unlink(e);
+        pushFront(e);
+        route = m_entries[e].m_route;
+    }
+
+    directions = *route;                    //outside the lock; the route itself is never modified
+    return true;
+}
+
+void RouteCache::insert(int source, int target, const vector<NavSegment>& directions)
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if (m_capacity == 0)
+            return;
+    }
+
+    Route route = make_shared<const vector<NavSegment>>(directions);   //copied without holding the lock
+    uint64_t key = keyOf(source, target);
+
+    lock_guard<mutex> lock(m_mutex);
+
+    if (m_capacity == 0)                    //turned off meanwhile
+        return;
+
+    const int* existing = m_index.find(key);
+    if (existing != nullptr) {              //another thread got there first
+        int e = *existing;
+        m_entries[e].m_route = route;
+        unlink(e);
+        pushFront(e);
+        return;
+    }
+
+    if (m_entries.size() >= m_capacity)
+        evictTail();
+
+    Entry entry = { key, route, -1, -1 };
+    int e = static_cast<int>(m_entries.size());
+    m_entries.push_back(entry);
+    m_index.associate(key, e);
+    pushFront(e);
+}
+
+void RouteCache::clear()
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    m_entries.clear();
+    m_index.clear();
+    m_head = m_tail = -1;
+}
+
+void RouteCache::eraseIf(const function<bool(int, int, const vector<NavSegment>&)>& drop)
+{
+    lock_guard<mutex> lock(m_mutex);
+
+        //from the back, so that the entry erase moves into a freed place has been looked at already
+    for (int e = static_cast<int>(m_entries.size()) - 1; e >= 0; e--) {
+        uint64_t key = m_entries[e].m_key;
+        if (drop(static_cast<int>(key >> 32), static_cast<int>(static_cast<uint32_t>(key)), *m_entries[e].m_route))
+            erase(e);
+    }
+}
+
+RouteCacheStats RouteCache::stats() const
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    RouteCacheStats s = m_stats;
+    s.size = m_entries.size();
+    s.capacity = m_capacity;
+    return s;
+}
+
+/* private member functions */
+
+uint64_t RouteCache::keyOf(int source, int target)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(source)) << 32) | static_cast<uint32_t>(target);
+}
+
+void RouteCache::unlink(int entry)
+{
+    Entry& e = m_entries[entry];
+
+    if (e.m_prev != -1)
+        m_entries[e.m_prev].m_next = e.m_next;
+    else
+        m_head = e.m_next;
+
+    if (e.m_next != -1)
+        m_entries[e.m_next].m_prev = e.m_prev;
+    else
+        m_tail = e.m_prev;
+
+    e.m_prev = e.m_next = -1;
+}
+
+void RouteCache::pushFront(int entry)
+{
+    Entry& e = m_entries[entry];
+    e.m_prev = -1;
+    e.m_next = m_head;
+
+    if (m_head != -1)
+        m_entries[m_head].m_prev = entry;
+    m_head = entry;
+
+    if (m_tail == -1)
+        m_tail = entry;
+}
+
+void RouteCache::evictTail()
+{
+    if (m_tail == -1)
+        return;
+
+    m_stats.evictions++;
+    erase(m_tail);
+}
+
+void RouteCache::erase(int victim)
+{
+    unlink(victim);
+    m_index.remove(m_entries[victim].m_key);
+
+        //keep the array dense by moving the last entry into the victim's place
+    int last = static_cast<int>(m_entries.size()) - 1;
+    if (victim != last) {
+        Entry& moved = m_entries[last];
+        if (moved.m_prev != -1)
+            m_entries[moved.m_prev].m_next = victim;
+        else
+            m_head = victim;
+        if (moved.m_next != -1)
+            m_entries[moved.m_next].m_prev = victim;
+        else
+            m_tail = victim;
+
+        m_index.associate(moved.m_key, victim);
+        m_entries[victim] = moved;
+    }
+    m_entries.pop_back();
+}
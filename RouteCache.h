@@ -0,0 +1,73 @@
+// RouteCache.h
+
+#ifndef ROUTECACHE_INCLUDED
+#define ROUTECACHE_INCLUDED
+
+#include "provided.h"
+#include "MyMap.h"
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+// A bounded, least-recently-used cache of computed directions, keyed on the
+// RoadGraph node IDs of the two ends, so that every spelling of an attraction
+// name that resolves to the same place shares an entry. All functions may be
+// called from any number of threads at once.
+//
+// The entries live in a fixed array threaded onto a doubly linked recency
+// list by index, and MyMap finds an entry by key. A cached route is held by a
+// shared_ptr, so a hit only copies the directions after the lock is released.
+
+class RouteCache
+{
+public:
+    RouteCache();
+    ~RouteCache();
+
+        //0 turns the cache off; shrinking it evicts the least recently used routes
+    void setCapacity(size_t routes);
+
+        //copies the cached directions from source to target into directions, if there are any
+    bool lookup(int source, int target, std::vector<NavSegment>& directions);
+    void insert(int source, int target, const std::vector<NavSegment>& directions);
+
+        //drops every route (the counters keep counting)
+    void clear();
+        //drops the routes for which drop(source, target, directions) is true, as clear does
+    void eraseIf(const std::function<bool(int, int, const std::vector<NavSegment>&)>& drop);
+    RouteCacheStats stats() const;
+
+      // We prevent a RouteCache object from being copied or assigned.
+    RouteCache(const RouteCache&) = delete;
+    RouteCache& operator=(const RouteCache&) = delete;
+
+private:
+    typedef std::shared_ptr<const std::vector<NavSegment>> Route;
+
+    struct Entry {
+        uint64_t m_key;
+        Route m_route;
+        int m_prev;                         // neighbours in the recency list, -1 at the ends
+        int m_next;
+    };
+
+    mutable std::mutex m_mutex;
+    size_t m_capacity;
+    std::vector<Entry> m_entries;           // never more than m_capacity of them
+    MyMap<uint64_t, int> m_index;           // key -> index in m_entries
+    int m_head;                             // most recently used, -1 if empty
+    int m_tail;                             // least recently used
+    RouteCacheStats m_stats;
+
+    /* private member functions */
+    static uint64_t keyOf(int source, int target);
+    void unlink(int entry);
+    void pushFront(int entry);
+    void evictTail();
+    void erase(int entry);
+};
+
+#endif // ROUTECACHE_INCLUDED
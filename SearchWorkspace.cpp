@@ -0,0 +1,94 @@
+#include "SearchWorkspace.h"
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <climits>
+using namespace std;
+
+SearchWorkspace::SearchWorkspace() : m_queue(QUEUE_QUATERNARY), m_queueInUse(QUEUE_QUATERNARY), m_prefetcher(nullptr),
+                                     m_counting(false), m_generation(0)
+{
+    m_counters = SearchCounters();
+}
+
+void SearchWorkspace::reset(int numNodes)
+{
+    size_t n = static_cast<size_t>(numNodes);
+    if (m_dist.size() < n) {                        //new entries start out in generation 0, which is never current
+        m_reachedIn.resize(n, 0);
+        m_settledIn.resize(n, 0);
+        m_dist.resize(n);
+        m_parent.resize(n);
+        m_parentEdge.resize(n);
+    }
+
+    m_generation++;
+    if (m_generation == 0) {                        //wrapped around; old stamps could look current again
+        fill(m_reachedIn.begin(), m_reachedIn.end(), 0);
+        fill(m_settledIn.begin(), m_settledIn.end(), 0);
+        m_generation = 1;
+    }
+
+    m_tile = TileCursor();
+    if (m_prefetcher == nullptr)
+        m_tile.m_last = INT_MAX;
+
+    m_queueInUse = m_queue;
+    switch (m_queueInUse) {
+        case QUEUE_QUATERNARY:  m_quaternary.reset(numNodes); break;
+        case QUEUE_RADIX:       m_radix.reset(numNodes); break;
+        default:                m_binary.reset(numNodes); break;
+    }
+}
+
+bool SearchWorkspace::heapEmpty() const
+{
+    switch (m_queueInUse) {
+        case QUEUE_QUATERNARY:  return m_quaternary.empty();
+        case QUEUE_RADIX:       return m_radix.empty();
+        default:                return m_binary.empty();
+    }
+}
+
+size_t SearchWorkspace::heapSize() const
+{
+    switch (m_queueInUse) {
+        case QUEUE_QUATERNARY:  return m_quaternary.size();
+        case QUEUE_RADIX:       return m_radix.size();
+        default:                return m_binary.size();
+    }
+}
+
+double SearchWorkspace::heapMin()
+{
+    switch (m_queueInUse) {
+        case QUEUE_QUATERNARY:  return m_quaternary.minKey();
+        case QUEUE_RADIX:       return m_radix.minKey();
+        default:                return m_binary.minKey();
+    }
+}
+
+void SearchWorkspace::push(double weight, int node)
+{
+    switch (m_queueInUse) {
+        case QUEUE_QUATERNARY:  m_quaternary.push(weight, node); break;
+        case QUEUE_RADIX:       m_radix.push(weight, node); break;
+        default:                m_binary.push(weight, node); break;
+    }
+    NAV_COUNT(m_counters.m_pushes++; m_counters.m_peakHeap = max(m_counters.m_peakHeap, heapSize());)
+}
+
+nodePair SearchWorkspace::pop()
+{
+    switch (m_queueInUse) {
+        case QUEUE_QUATERNARY:  return m_quaternary.pop();
+        case QUEUE_RADIX:       return m_radix.pop();
+        default:                return m_binary.pop();
+    }
+}
+
+SearchWorkspace& SearchWorkspace::forThisThread(int slot)
+{
+    static thread_local SearchWorkspace workspaces[numSlots];
+    return workspaces[slot];
+}
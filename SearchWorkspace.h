@@ -0,0 +1,134 @@
+// SearchWorkspace.h
+
+#ifndef SEARCHWORKSPACE_INCLUDED
+#define SEARCHWORKSPACE_INCLUDED
+
+#include "provided.h"
+#include "OpenList.h"
+#include "TilePrefetcher.h"
+#include <vector>
+#include <utility>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Scratch state for one shortest-path search over a RoadGraph: the tentative
+// distance, predecessor (node and edge) and settled flag of every node, plus
+// the open list.
+// The per-node arrays are dense and indexed by node ID. Rather than clearing
+// them before each search, every entry carries the generation it was written
+// in, and entries from older generations read as "not reached". Starting a
+// search is therefore O(1), and a workspace that is reused does no allocation
+// once it has grown to the size of the graph.
+//
+// A workspace must only be used by one search at a time. forThisThread()
+// hands out one per thread, which is what lets Navigator::navigate run
+// concurrently on a shared Navigator.
+//
+// The open list is one of the queues in OpenList.h, chosen with setQueue; a
+// search works the same way with any of them.
+//
+// Settling a node outside the tile the search was last in tells the workspace's
+// TilePrefetcher, if it has one, so that the map can be read ahead a tile at a time.
+//
+// A workspace also counts what its searches do (see NavStats in provided.h),
+// but only while setCounting(true) is in effect, which Navigator does only for
+// a query given a NavStats. Building with -DNAV_STATS=0 compiles the counting
+// out altogether.
+
+#ifndef NAV_STATS
+#define NAV_STATS 1
+#endif
+
+#if NAV_STATS
+#define NAV_COUNT(statement) if (m_counting) { statement }
+#else
+#define NAV_COUNT(statement)
+#endif
+
+struct SearchCounters
+{
+    std::size_t m_settled;
+    std::size_t m_relaxed;                  // edges looked at from settled nodes
+    std::size_t m_pushes;
+    std::size_t m_stalePops;                // heap entries of nodes settled already
+    std::size_t m_peakHeap;
+    std::size_t m_touched;                  // distinct nodes reached
+};
+
+class SearchWorkspace
+{
+public:
+    SearchWorkspace();
+
+        //starts a new search over a graph of numNodes nodes
+    void reset(int numNodes);
+
+    bool reached(int node) const { return m_reachedIn[node] == m_generation; }
+    bool settled(int node) const { return m_settledIn[node] == m_generation; }
+    double dist(int node) const { return m_dist[node]; }        //only meaningful once reached
+    int parent(int node) const { return m_parent[node]; }       //-1 for the source
+    int parentEdge(int node) const { return m_parentEdge[node]; }   //edge node was reached over, -1 if none
+
+    void reach(int node, double dist, int parent, int edge = -1)
+    {
+        NAV_COUNT(if (m_reachedIn[node] != m_generation) m_counters.m_touched++;)
+        m_reachedIn[node] = m_generation; m_dist[node] = dist; m_parent[node] = parent; m_parentEdge[node] = edge;
+    }
+    void settle(int node)
+    {
+        m_settledIn[node] = m_generation; NAV_COUNT(m_counters.m_settled++;)
+        if (node < m_tile.m_first || node >= m_tile.m_last)
+            m_prefetcher->enter(node, m_tile);
+    }
+
+        //the open list, a min-queue on weight; push lowers the weight of a node queued already,
+        //or (depending on the queue) queues it again, leaving a stale entry to be skipped
+    void setQueue(QueueKind kind) { m_queue = kind; }       //takes effect at the next reset
+    void setPrefetcher(const TilePrefetcher* prefetcher) { m_prefetcher = prefetcher; }   //likewise; nullptr for none
+    void setCounting(bool counting) { m_counting = counting; }    //whether m_counters are kept; off to start with
+    bool heapEmpty() const;
+    std::size_t heapSize() const;
+    double heapMin();
+    void push(double weight, int node);
+    nodePair pop();
+
+        //room for the caller to build its result in: a route's nodes, destination first,
+        //and in m_pathEdges[i] the RoadGraph edge joining m_path[i] and m_path[i+1]
+    std::vector<int> m_path;
+    std::vector<int> m_pathEdges;
+
+        //for the searches to report what the workspace cannot see for itself
+    void noteStalePop() { NAV_COUNT(m_counters.m_stalePops++;) }
+    void noteRelaxed(int edges) { NAV_COUNT(m_counters.m_relaxed += edges;) (void)edges; }
+    void noteSearchDone() { m_searchDone = std::chrono::steady_clock::now(); }     //before the path is pieced together
+
+    SearchCounters m_counters;              //all zero unless NAV_STATS and counting; the caller zeroes them
+    std::chrono::steady_clock::time_point m_searchDone;
+
+        //the calling thread's own workspaces; a bidirectional search uses slots 0 and 1
+    static const int numSlots = 2;
+    static SearchWorkspace& forThisThread(int slot = 0);
+
+      // We prevent a SearchWorkspace object from being copied or assigned.
+    SearchWorkspace(const SearchWorkspace&) = delete;
+    SearchWorkspace& operator=(const SearchWorkspace&) = delete;
+
+private:
+    QueueKind m_queue;
+    QueueKind m_queueInUse;                 // m_queue as of the last reset
+    const TilePrefetcher* m_prefetcher;
+    bool m_counting;
+    TileCursor m_tile;                      // every node, if there is no prefetcher
+    uint32_t m_generation;
+    std::vector<uint32_t> m_reachedIn;      // generation in which each node was last reached
+    std::vector<uint32_t> m_settledIn;      // ... and settled
+    std::vector<double> m_dist;
+    std::vector<int> m_parent;
+    std::vector<int> m_parentEdge;
+    BinaryOpenList m_binary;
+    QuaternaryOpenList m_quaternary;
+    RadixOpenList m_radix;
+};
+
+#endif // SEARCHWORKSPACE_INCLUDED
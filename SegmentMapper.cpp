@@ -3,8 +3,29 @@
 #include "support.h"
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <thread>
+#include <memory>
+#include <cstdint>
 using namespace std;
 
+namespace {
+
+    const int minSegmentsPerThread = 1 << 14;   //smaller maps are not worth splitting
+
+        //calls f(0) .. f(n-1) at once, f(0) on the calling thread
+    template<typename F>
+    void parallelFor(int n, F f) {
+        vector<thread> workers;
+        for (int i = 1; i < n; i++)
+            workers.push_back(thread(f, i));
+        if (n > 0)
+            f(0);
+        for (size_t i = 0; i < workers.size(); i++)
+            workers[i].join();
+    }
+}
+
 class SegmentMapperImpl
 {
 public:
@@ -12,11 +33,30 @@ public:
 	~SegmentMapperImpl();
 	void init(const MapLoader& ml);
 	vector<StreetSegment> getSegments(const GeoCoord& gc) const;
+    SegmentIdRange getSegmentIds(const FixedCoord& fc) const;
+    const SegmentRecord& getSegmentRecord(int segId) const { return m_tables.segments[segId]; }
+    const AttractionRecord& getAttractionRecord(int index) const { return m_tables.attractions[index]; }
+    StreetSegment getSegment(int segId) const;
+    int getStreetNameId(int segId) const { return m_tables.segments[segId].name; }
+    size_t getNumSegments() const { return m_tables.segments.size(); }
 private:
-    MyMap<GeoCoord, vector<StreetSegment>> m_map;
+    MapTables m_tables;                     //the loader's records, shared rather than copied: every segment is
+                                            //stored exactly once, indexed by segment ID, with each street and
+                                            //attraction name stored once in the name table
+    
+    unique_ptr<MyMap<FixedCoord, int>[]> m_rows;    //coordinate -> row of the index below, less m_rowBase of its
+    vector<int> m_rowBase;                  //part; the coordinates are split into parts by hash, so that init can build
+                                            //the parts at once
+    vector<int> m_offsets;                  //segment IDs of row r are m_ids[m_offsets[r]] .. m_ids[m_offsets[r+1]-1],
+    vector<int> m_ids;                      //ascending
+    
+    /* private member functions */
+    size_t partOf(const FixedCoord& fc) const;
+    int findRow(const FixedCoord& fc) const;                    //row listing fc, or -1
+    void keysOf(int segId, vector<FixedCoord>& keys) const;     //the coordinates segment segId is listed under
 };
 
-SegmentMapperImpl::SegmentMapperImpl()
+SegmentMapperImpl::SegmentMapperImpl() : m_rows(new MyMap<FixedCoord, int>[1]), m_rowBase(1, 0), m_offsets(1, 0)
 {
 }
 
@@ -26,65 +66,124 @@ SegmentMapperImpl::~SegmentMapperImpl()
 
 void SegmentMapperImpl::init(const MapLoader& ml)
 {
-    for (int i = 0; i < ml.getNumSegments(); i++) {
-        
-        StreetSegment seg;
-        
-        ml.getSegment(i, seg);
+    m_tables.share(ml.getTables());
     
-        GeoCoord start(seg.segment.start.latitudeText, seg.segment.start.longitudeText);
-        GeoCoord end(seg.segment.end.latitudeText, seg.segment.end.longitudeText);
-        
-        vector<StreetSegment>* vec = m_map.find(start);
-        
-        if (vec == nullptr) {               //create new pair if key not present
-            vector<StreetSegment> temp;
-            temp.push_back(seg);
-            m_map.associate(start, temp);
-        }                                   //add StreetSegment to value vector if key present
-        else
-            (*vec).push_back(seg);
-        
-        vec = m_map.find(end);
-        
-        if (vec == nullptr) {               //create new pair if key not present
-            vector<StreetSegment> temp;
-            temp.push_back(seg);
-            m_map.associate(end, temp);
-        }                                   //add StreetSegment to value vector if key present
-        else
-            (*vec).push_back(seg);
-        
-        for (int i = 0; i < seg.attractions.size(); i++) {  //Attractions
-            
-            GeoCoord key(seg.attractions[i].geocoordinates.latitudeText,
-                            seg.attractions[i].geocoordinates.longitudeText);
-            
-            if (key == start || key == end) //StreetSegment already associated with geocoordinate
-                continue;
-            
-            vec = m_map.find(key);
-            
-            if (vec == nullptr) {           //create new pair if key not present
-                vector<StreetSegment> temp;
-                temp.push_back(seg);
-                m_map.associate(key, temp);
-            }
-            else                            //add StreetSegment to value vector if key present
-                (*vec).push_back(seg);
+        //as many parts as threads. Each thread first deals the keys of a run of segments out to the parts
+        //(start, end, and any attraction not at either), and then lays out the rows of one part, taking
+        //the runs in order so that the segment IDs of a row come out ascending
+    int numSegments = static_cast<int>(m_tables.segments.size());
+    int numParts = max(1, min(static_cast<int>(thread::hardware_concurrency()), numSegments / minSegmentsPerThread));
+    m_rows.reset(new MyMap<FixedCoord, int>[numParts]);
+    m_rowBase.assign(numParts, 0);
+    
+    typedef pair<FixedCoord, int> keyPair;  //(coordinate, segment ID)
+    vector<vector<vector<keyPair>>> keys(numParts, vector<vector<keyPair>>(numParts));  //keys[run][part]
+    
+    parallelFor(numParts, [this, &keys, numSegments, numParts](int run) {
+        vector<FixedCoord> segKeys;
+        int first = static_cast<int>(static_cast<int64_t>(numSegments) * run / numParts);
+        int last = static_cast<int>(static_cast<int64_t>(numSegments) * (run + 1) / numParts);
+        for (int i = first; i < last; i++) {
+            keysOf(i, segKeys);
+            for (size_t k = 0; k < segKeys.size(); k++)
+                keys[run][partOf(segKeys[k])].push_back(make_pair(segKeys[k], i));
         }
+    });
+    
+    vector<vector<int>> counts(numParts);   //number of segments in each row of a part
+    vector<vector<int>> keyRows(numParts);  //row of each pair of a part, runs in order
+    
+    parallelFor(numParts, [this, &keys, &counts, &keyRows, numParts](int part) {
+        for (int run = 0; run < numParts; run++)
+            for (size_t k = 0; k < keys[run][part].size(); k++) {
+                const FixedCoord& fc = keys[run][part][k].first;
+                const int* found = m_rows[part].find(fc);
+                int row = (found != nullptr) ? *found : static_cast<int>(counts[part].size());
+                if (found == nullptr) {
+                    m_rows[part].associate(fc, row);
+                    counts[part].push_back(0);
+                }
+                counts[part][row]++;
+                keyRows[part].push_back(row);
+            }
+    });
+    
+        //lay the parts out one after another, and the rows of each contiguously
+    m_offsets.assign(1, 0);
+    for (int part = 0; part < numParts; part++) {
+        m_rowBase[part] = static_cast<int>(m_offsets.size()) - 1;
+        for (size_t r = 0; r < counts[part].size(); r++)
+            m_offsets.push_back(m_offsets.back() + counts[part][r]);
     }
+    
+    m_ids.resize(m_offsets.back());
+    vector<int> next(m_offsets.begin(), m_offsets.end() - 1);
+    
+    parallelFor(numParts, [this, &keys, &keyRows, &next, numParts](int part) {
+        size_t k = 0;
+        for (int run = 0; run < numParts; run++) {
+            for (size_t i = 0; i < keys[run][part].size(); i++, k++)
+                m_ids[next[m_rowBase[part] + keyRows[part][k]]++] = keys[run][part][i].second;
+            vector<keyPair>().swap(keys[run][part]);
+        }
+    });
 }
 
 vector<StreetSegment> SegmentMapperImpl::getSegments(const GeoCoord& gc) const
 {
-    GeoCoord temp(gc.latitudeText, gc.longitudeText);
-    const vector<StreetSegment>* vec = m_map.find(temp);
-	
-    if (vec == nullptr)
-        return vector<StreetSegment>();
-    else
-        return *vec;
+    SegmentIdRange ids = getSegmentIds(toFixed(gc));
+    
+    vector<StreetSegment> result(ids.size());
+    for (size_t i = 0; i < ids.size(); i++)
+        buildStreetSegment(m_tables, ids[i], result[i]);
+    
+    return result;
+}
+
+StreetSegment SegmentMapperImpl::getSegment(int segId) const
+{
+    StreetSegment seg;
+    buildStreetSegment(m_tables, segId, seg);
+    return seg;
+}
+
+SegmentIdRange SegmentMapperImpl::getSegmentIds(const FixedCoord& fc) const
+{
+    int row = findRow(fc);
+    
+    if (row == -1)
+        return SegmentIdRange();
+    
+    const int* base = m_ids.data();
+    return SegmentIdRange(base + m_offsets[row], base + m_offsets[row + 1]);
+}
+
+/* private member functions */
+
+size_t SegmentMapperImpl::partOf(const FixedCoord& fc) const
+{
+    uint64_t h = hash<FixedCoord>()(fc) * 0x9E3779B97F4A7C15ULL;     //spread the bits before taking the top ones
+    return static_cast<size_t>((h >> 32) % m_rowBase.size());
+}
+
+int SegmentMapperImpl::findRow(const FixedCoord& fc) const
+{
+    size_t part = partOf(fc);
+    const int* row = m_rows[part].find(fc);
+    return (row != nullptr) ? m_rowBase[part] + *row : -1;
+}
+
+void SegmentMapperImpl::keysOf(int segId, vector<FixedCoord>& keys) const
+{
+    const SegmentRecord& seg = m_tables.segments[segId];
+    
+    keys.clear();
+    keys.push_back(seg.start);
+    for (int j = -1; j < seg.numAttractions; j++) {
+        const FixedCoord& key = (j == -1) ? seg.end : m_tables.attractions[seg.firstAttraction + j].coord;
+        if (find(keys.begin(), keys.end(), key) == keys.end())
+            keys.push_back(key);
+    }
 }
 
 //******************** SegmentMapper functions ********************************
@@ -111,3 +210,38 @@ vector<StreetSegment> SegmentMapper::getSegments(const GeoCoord& gc) const
 {
 	return m_impl->getSegments(gc);
 }
+
+SegmentIdRange SegmentMapper::getSegmentIds(const GeoCoord& gc) const
+{
+	return m_impl->getSegmentIds(toFixed(gc));
+}
+
+SegmentIdRange SegmentMapper::getSegmentIds(const FixedCoord& fc) const
+{
+	return m_impl->getSegmentIds(fc);
+}
+
+const SegmentRecord& SegmentMapper::getSegmentRecord(int segId) const
+{
+	return m_impl->getSegmentRecord(segId);
+}
+
+const AttractionRecord& SegmentMapper::getAttractionRecord(int index) const
+{
+	return m_impl->getAttractionRecord(index);
+}
+
+StreetSegment SegmentMapper::getSegment(int segId) const
+{
+	return m_impl->getSegment(segId);
+}
+
+int SegmentMapper::getStreetNameId(int segId) const
+{
+	return m_impl->getStreetNameId(segId);
+}
+
+size_t SegmentMapper::getNumSegments() const
+{
+	return m_impl->getNumSegments();
+}
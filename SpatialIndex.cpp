@@ -0,0 +1,287 @@
+#include "SpatialIndex.h"
+#include "MapSnapshot.h"
+#include "provided.h"
+#include "support.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+using namespace std;
+
+namespace {
+
+        //squared distance in the plane from the origin to the segment from (ax, ay) to (bx, by),
+        //with t set to how far along the segment the closest point lies, from 0 to 1
+    double distanceToSegment(double ax, double ay, double bx, double by, double& t) {
+
+        double dx = bx - ax;
+        double dy = by - ay;
+        double length2 = dx * dx + dy * dy;
+
+        t = 0;
+        if (length2 > 0)
+            t = min(1.0, max(0.0, -(ax * dx + ay * dy) / length2));
+
+        double px = ax + t * dx;
+        double py = ay + t * dy;
+        return px * px + py * py;
+    }
+
+        //column or row of the cell holding plane coordinate v
+    int cellOf(double v, double cellSize, int count) {
+        return min(count - 1, max(0, static_cast<int>(v / cellSize)));
+    }
+}
+
+SpatialIndex::SpatialIndex()
+{
+}
+
+SpatialIndex::~SpatialIndex()
+{
+}
+
+void SpatialIndex::clear()
+{
+    m_shape.clear();
+    m_offsets.clear();
+    m_entries.clear();
+    m_added.clear();
+}
+
+void SpatialIndex::build(const MapLoader& ml)
+{
+    clear();
+
+    const MapSnapshot* snap = ml.getSnapshot();
+    if (snap != nullptr && snap->get(SNAP_GRID_SHAPE, m_shape) && snap->get(SNAP_GRID_OFFSETS, m_offsets) &&
+        snap->get(SNAP_GRID_ENTRIES, m_entries) && m_shape.size() == 1)
+        return;                                 //index was compiled into the snapshot
+
+    clear();
+
+    const MapTables& tables = ml.getTables();
+    size_t n = tables.segments.size();
+    if (n == 0)
+        return;
+
+    FixedCoord lo = tables.segments[0].start;
+    FixedCoord hi = lo;
+    for (size_t i = 0; i < n; i++) {
+        const SegmentRecord& seg = tables.segments[i];
+        lo.lat = min(lo.lat, min(seg.start.lat, seg.end.lat));
+        lo.lon = min(lo.lon, min(seg.start.lon, seg.end.lon));
+        hi.lat = max(hi.lat, max(seg.start.lat, seg.end.lat));
+        hi.lon = max(hi.lon, max(seg.start.lon, seg.end.lon));
+    }
+
+        //square cells, one for every two segments; smaller cells make queries near a street
+        //slightly faster and queries far from any much slower
+    Shape shape;
+    shape.m_origin = lo;
+    shape.m_lonScale = cos(deg2rad((lo.latitude() + hi.latitude()) / 2));
+    double width = max(1.0, (static_cast<double>(hi.lon) - lo.lon) * shape.m_lonScale);
+    double height = max(1.0, static_cast<double>(hi.lat) - lo.lat);
+    shape.m_cellSize = max(1.0, sqrt(2 * width * height / n));
+    shape.m_cols = static_cast<int32_t>(width / shape.m_cellSize) + 1;
+    shape.m_rows = static_cast<int32_t>(height / shape.m_cellSize) + 1;
+
+        //the cells each segment's bounding box overlaps
+    vector<int> firstCol(n), lastCol(n), firstRow(n), lastRow(n);
+    vector<int32_t> offsets(static_cast<size_t>(shape.m_cols) * shape.m_rows + 1, 0);
+    for (size_t i = 0; i < n; i++) {
+
+        const SegmentRecord& seg = tables.segments[i];
+        double x1 = (static_cast<double>(seg.start.lon) - lo.lon) * shape.m_lonScale;
+        double x2 = (static_cast<double>(seg.end.lon) - lo.lon) * shape.m_lonScale;
+        double y1 = static_cast<double>(seg.start.lat) - lo.lat;
+        double y2 = static_cast<double>(seg.end.lat) - lo.lat;
+
+        firstCol[i] = cellOf(min(x1, x2), shape.m_cellSize, shape.m_cols);
+        lastCol[i] = cellOf(max(x1, x2), shape.m_cellSize, shape.m_cols);
+        firstRow[i] = cellOf(min(y1, y2), shape.m_cellSize, shape.m_rows);
+        lastRow[i] = cellOf(max(y1, y2), shape.m_cellSize, shape.m_rows);
+
+        for (int row = firstRow[i]; row <= lastRow[i]; row++)
+            for (int col = firstCol[i]; col <= lastCol[i]; col++)
+                offsets[row * shape.m_cols + col + 1]++;
+    }
+    for (size_t c = 1; c < offsets.size(); c++)
+        offsets[c] += offsets[c - 1];
+
+    vector<Entry> entries(offsets.back());
+    vector<int32_t> next(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < n; i++) {
+
+        const SegmentRecord& seg = tables.segments[i];
+        Entry e = { static_cast<int32_t>(i), seg.start, seg.end };
+        for (int row = firstRow[i]; row <= lastRow[i]; row++)
+            for (int col = firstCol[i]; col <= lastCol[i]; col++)
+                entries[next[row * shape.m_cols + col]++] = e;
+    }
+
+    vector<Shape> shapes(1, shape);
+    m_shape.adopt(shapes);
+    m_offsets.adopt(offsets);
+    m_entries.adopt(entries);
+}
+
+void SpatialIndex::save(SnapshotWriter& w) const
+{
+    w.add(SNAP_GRID_SHAPE, m_shape);
+    w.add(SNAP_GRID_OFFSETS, m_offsets);
+    w.add(SNAP_GRID_ENTRIES, m_entries);
+}
+
+void SpatialIndex::add(int segment, const FixedCoord& start, const FixedCoord& end)
+{
+    Entry e = { segment, start, end };
+    m_added.push_back(e);
+}
+
+void SpatialIndex::setSnappable(int segment, const FixedCoord& start, const FixedCoord& end, bool snappable)
+{
+    int32_t from = snappable ? ~segment : segment;
+    int32_t to = snappable ? segment : ~segment;
+
+    for (size_t i = 0; i < m_added.size(); i++)
+        if (m_added[i].m_segment == from)
+            m_added[i].m_segment = to;
+
+    if (m_shape.empty())
+        return;
+
+        //the cells the segment's bounding box overlaps, as build listed it
+    int shapeCols = m_shape[0].m_cols;
+    int firstCol = min(colOf(start), colOf(end)), lastCol = max(colOf(start), colOf(end));
+    int firstRow = min(rowOf(start), rowOf(end)), lastRow = max(rowOf(start), rowOf(end));
+    for (int row = firstRow; row <= lastRow; row++)
+        for (int col = firstCol; col <= lastCol; col++) {
+            int c = row * shapeCols + col;
+            for (int32_t i = m_offsets[c]; i < m_offsets[c + 1]; i++)
+                if (m_entries[i].m_segment == from)
+                    m_entries.edit(i).m_segment = to;
+        }
+}
+
+void SpatialIndex::find(const FixedCoord& a, const FixedCoord& b, vector<int>& segments) const
+{
+    auto check = [&](const Entry& e) {
+        if ((e.m_start == a && e.m_end == b) || (e.m_start == b && e.m_end == a))
+            segments.push_back(e.m_segment < 0 ? ~e.m_segment : e.m_segment);
+    };
+
+    for (size_t i = 0; i < m_added.size(); i++)
+        check(m_added[i]);
+
+    if (m_shape.empty())
+        return;
+
+    int c = rowOf(a) * m_shape[0].m_cols + colOf(a);       //every segment ending at a is listed there
+    for (int32_t i = m_offsets[c]; i < m_offsets[c + 1]; i++)
+        check(m_entries[i]);
+}
+
+bool SpatialIndex::nearest(const FixedCoord& fc, SegmentSnap& snap) const
+{
+    Closest closest = { numeric_limits<double>::infinity(), nullptr, 0 };
+
+    if (!m_shape.empty())
+        searchGrid(fc, closest);
+
+    double scale = m_shape.empty() ? cos(deg2rad(fc.latitude())) : m_shape[0].m_lonScale;
+    for (size_t i = 0; i < m_added.size(); i++)
+        consider(m_added[i], fc, scale, closest);
+
+    const Entry* best = closest.m_entry;
+    if (best == nullptr)
+        return false;
+
+    snap.segment = best->m_segment;
+    snap.point.lat = best->m_start.lat + static_cast<int32_t>(llround(closest.m_t * (static_cast<double>(best->m_end.lat) - best->m_start.lat)));
+    snap.point.lon = best->m_start.lon + static_cast<int32_t>(llround(closest.m_t * (static_cast<double>(best->m_end.lon) - best->m_start.lon)));
+    return true;
+}
+
+/* private member functions */
+
+void SpatialIndex::consider(const Entry& e, const FixedCoord& fc, double scale, Closest& closest)
+{
+    if (e.m_segment < 0)
+        return;
+
+    double t;
+    double d = distanceToSegment((static_cast<double>(e.m_start.lon) - fc.lon) * scale,
+                                 static_cast<double>(e.m_start.lat) - fc.lat,
+                                 (static_cast<double>(e.m_end.lon) - fc.lon) * scale,
+                                 static_cast<double>(e.m_end.lat) - fc.lat, t);
+    if (d < closest.m_dist2) {
+        closest.m_dist2 = d;
+        closest.m_entry = &e;
+        closest.m_t = t;
+    }
+}
+
+void SpatialIndex::searchGrid(const FixedCoord& fc, Closest& closest) const
+{
+    const Shape& shape = m_shape[0];
+    double scale = shape.m_lonScale;
+
+        //the query's cell, which may lie outside the grid, and how close it is to that cell's sides
+    double gx = (static_cast<double>(fc.lon) - shape.m_origin.lon) * scale / shape.m_cellSize;
+    double gy = (static_cast<double>(fc.lat) - shape.m_origin.lat) / shape.m_cellSize;
+    long long cx = static_cast<long long>(floor(gx));
+    long long cy = static_cast<long long>(floor(gy));
+    double fx = gx - cx;
+    double fy = gy - cy;
+    double inset = min(min(fx, 1 - fx), min(fy, 1 - fy)) * shape.m_cellSize;
+
+    long long lastCol = shape.m_cols - 1;
+    long long lastRow = shape.m_rows - 1;
+    long long firstRing = max(max(0LL, max(-cx, cx - lastCol)), max(-cy, cy - lastRow));
+    long long lastRing = max(max(cx, lastCol - cx), max(cy, lastRow - cy));
+
+    auto scan = [&](long long col, long long row) {
+        size_t c = static_cast<size_t>(row * shape.m_cols + col);
+        for (int32_t i = m_offsets[c]; i < m_offsets[c + 1]; i++)
+            consider(m_entries[i], fc, scale, closest);
+    };
+
+        //ring r is the cells r steps from the query's cell; nothing in it is nearer than r-1 cells
+        //plus the query's distance to the side of its own cell
+    for (long long r = firstRing; r <= lastRing; r++) {
+
+        if (closest.m_entry != nullptr && r > 0) {
+            double ringDist = (r - 1) * shape.m_cellSize + inset;
+            if (ringDist * ringDist >= closest.m_dist2)
+                break;
+        }
+
+        long long colLo = max(0LL, cx - r), colHi = min(lastCol, cx + r);
+        long long rowLo = max(0LL, cy - r + 1), rowHi = min(lastRow, cy + r - 1);
+        if (cy - r >= 0 && cy - r <= lastRow)
+            for (long long col = colLo; col <= colHi; col++)
+                scan(col, cy - r);
+        if (r > 0 && cy + r >= 0 && cy + r <= lastRow)
+            for (long long col = colLo; col <= colHi; col++)
+                scan(col, cy + r);
+        if (r > 0 && cx - r >= 0 && cx - r <= lastCol)
+            for (long long row = rowLo; row <= rowHi; row++)
+                scan(cx - r, row);
+        if (r > 0 && cx + r >= 0 && cx + r <= lastCol)
+            for (long long row = rowLo; row <= rowHi; row++)
+                scan(cx + r, row);
+    }
+}
+
+int SpatialIndex::colOf(const FixedCoord& fc) const
+{
+    const Shape& shape = m_shape[0];
+    return cellOf((static_cast<double>(fc.lon) - shape.m_origin.lon) * shape.m_lonScale, shape.m_cellSize, shape.m_cols);
+}
+
+int SpatialIndex::rowOf(const FixedCoord& fc) const
+{
+    const Shape& shape = m_shape[0];
+    return cellOf(static_cast<double>(fc.lat) - shape.m_origin.lat, shape.m_cellSize, shape.m_rows);
+}
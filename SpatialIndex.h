@@ -0,0 +1,95 @@
+// SpatialIndex.h
+
+#ifndef SPATIALINDEX_INCLUDED
+#define SPATIALINDEX_INCLUDED
+
+#include "provided.h"
+#include "support.h"
+#include <cstdint>
+#include <vector>
+
+// A uniform grid over the street segments of a map, for finding the segment
+// nearest to an arbitrary coordinate and the point on it closest to that
+// coordinate.
+//
+// Distances are measured in a local flat projection of the map: latitude as
+// is and longitude scaled by the cosine of the map's middle latitude, both in
+// FixedCoord units, which over a city is indistinguishable from the distance
+// on the ground. The grid's cells are square in that plane, one for every two
+// segments; a segment is listed in every cell its bounding box overlaps,
+// together with its two ends, so a query reads one flat run of entries per
+// cell. A query looks at the rings of cells around its own until the next
+// ring is farther away than the best segment found so far.
+//
+// The arrays are flat so that the index can be stored in a map snapshot.
+//
+// Segments can be taken out of and put back into consideration in place, by
+// flipping their entries, and segments added to the map after the index was
+// built are kept in a list that every query scans.
+
+    //the segment nearest to a coordinate, and the point on it closest to the coordinate
+struct SegmentSnap
+{
+    int32_t     segment;                    // index into MapTables::segments
+    FixedCoord  point;
+};
+
+class SpatialIndex
+{
+public:
+    SpatialIndex();
+    ~SpatialIndex();
+    void build(const MapLoader& ml);        // uses the snapshot's copy if ml was loaded from one
+    void clear();
+    void save(SnapshotWriter& w) const;
+    bool empty() const { return m_entries.empty() && m_added.empty(); }
+
+        //sets snap to the segment nearest fc; false if the map has no segments
+    bool nearest(const FixedCoord& fc, SegmentSnap& snap) const;
+
+        //adds segment, running from start to end, to the index
+    void add(int segment, const FixedCoord& start, const FixedCoord& end);
+        //whether nearest may pick segment, which runs from start to end
+    void setSnappable(int segment, const FixedCoord& start, const FixedCoord& end, bool snappable);
+        //appends to segments every segment with ends a and b, either way round, snappable or not
+    void find(const FixedCoord& a, const FixedCoord& b, std::vector<int>& segments) const;
+
+      // We prevent a SpatialIndex object from being copied or assigned.
+    SpatialIndex(const SpatialIndex&) = delete;
+    SpatialIndex& operator=(const SpatialIndex&) = delete;
+
+private:
+    struct Shape {
+        FixedCoord  m_origin;               // least latitude and longitude of any segment end
+        double      m_lonScale;             // x = (lon - origin.lon) * m_lonScale, y = lat - origin.lat
+        double      m_cellSize;             // side of a cell in the plane
+        int32_t     m_cols;
+        int32_t     m_rows;
+    };
+
+    struct Entry {
+        int32_t     m_segment;              // ~segment if it is not snappable
+        FixedCoord  m_start;
+        FixedCoord  m_end;
+    };
+
+    FlatArray<Shape> m_shape;               // one record
+    FlatArray<int32_t> m_offsets;           // entries of cell (col, row) are [m_offsets[c], m_offsets[c+1]), c = row * cols + col
+    FlatArray<Entry> m_entries;
+    std::vector<Entry> m_added;             // segments added since the index was built
+
+    struct Closest {                        // the best entry a query has found so far
+        double      m_dist2;                // squared distance in the plane
+        const Entry* m_entry;
+        double      m_t;                    // how far along it the closest point lies, from 0 to 1
+    };
+
+    /* private member functions */
+    static void consider(const Entry& e, const FixedCoord& fc, double scale, Closest& closest);
+    void searchGrid(const FixedCoord& fc, Closest& closest) const;
+        //column or row of the cell holding plane coordinate v of fc
+    int colOf(const FixedCoord& fc) const;
+    int rowOf(const FixedCoord& fc) const;
+};
+
+#endif // SPATIALINDEX_INCLUDED
@@ -0,0 +1,109 @@
+#include "TilePrefetcher.h"
+#include "provided.h"
+#include "support.h"
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+namespace {
+
+        //asks for the pages overlapping [first, last) to be read in
+    void prefetch(const char* first, const char* last) {
+#ifndef _WIN32
+        static const uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+        uintptr_t from = reinterpret_cast<uintptr_t>(first) / pageSize * pageSize;
+        uintptr_t to = reinterpret_cast<uintptr_t>(last);
+        if (from < to)
+            madvise(reinterpret_cast<void*>(from), to - from, MADV_WILLNEED);
+#else
+        (void)first;
+        (void)last;
+#endif
+    }
+}
+
+TilePrefetcher::TilePrefetcher() : m_firstNodes(nullptr), m_numTiles(0), m_on(false), m_enabled(false)
+{
+}
+
+TilePrefetcher::~TilePrefetcher()
+{
+}
+
+void TilePrefetcher::clear()
+{
+    m_firstNodes = nullptr;
+    m_numTiles = 0;
+    m_ranges.clear();
+    prepare();
+}
+
+void TilePrefetcher::setTiles(const FlatArray<int32_t>& firstNodes)
+{
+    m_firstNodes = firstNodes.data();
+    m_numTiles = firstNodes.empty() ? 0 : static_cast<int>(firstNodes.size()) - 1;
+    prepare();
+}
+
+void TilePrefetcher::setEnabled(bool on)
+{
+    m_on = on;
+    prepare();
+}
+
+void TilePrefetcher::enter(int node, TileCursor& cursor) const
+{
+    if (!m_enabled || node >= m_firstNodes[m_numTiles]) {   //nothing to ask for, or a node added since the tiles were made
+        cursor.m_first = m_enabled ? m_firstNodes[m_numTiles] : 0;
+        cursor.m_last = INT_MAX;
+        return;
+    }
+
+        //the last tile starting at or before node; empty tiles start where the next one does
+    int t = static_cast<int>(upper_bound(m_firstNodes, m_firstNodes + m_numTiles + 1, node) - m_firstNodes) - 1;
+    cursor.m_first = m_firstNodes[t];
+    cursor.m_last = m_firstNodes[t + 1];
+
+    if (!m_fetched[t].load(memory_order_relaxed) && !m_fetched[t].exchange(true, memory_order_relaxed))
+        forEachSpan(t, prefetch);
+}
+
+/* private member functions */
+
+void TilePrefetcher::addRange(const void* base, size_t elemSize, const int32_t* offsets)
+{
+    if (base == nullptr)
+        return;
+
+    Range r = { static_cast<const char*>(base), elemSize, offsets };
+    m_ranges.push_back(r);
+    prepare();
+}
+
+void TilePrefetcher::prepare()
+{
+    m_enabled = m_on && m_numTiles > 0 && !m_ranges.empty();
+    m_fetched.reset(new atomic<bool>[m_numTiles]);
+    for (int t = 0; t < m_numTiles; t++)
+        m_fetched[t].store(false, memory_order_relaxed);
+}
+
+template<typename F>
+void TilePrefetcher::forEachSpan(int t, F f) const
+{
+    int first = m_firstNodes[t];
+    int last = m_firstNodes[t + 1];
+    for (size_t i = 0; i < m_ranges.size(); i++) {
+        const Range& r = m_ranges[i];
+        size_t from = r.m_offsets == nullptr ? first : r.m_offsets[first];
+        size_t to = r.m_offsets == nullptr ? last : r.m_offsets[last];
+        if (from < to)
+            f(r.m_base + from * r.m_elemSize, r.m_base + to * r.m_elemSize);
+    }
+}
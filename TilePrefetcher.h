@@ -0,0 +1,88 @@
+// TilePrefetcher.h
+
+#ifndef TILEPREFETCHER_INCLUDED
+#define TILEPREFETCHER_INCLUDED
+
+#include "provided.h"
+#include "support.h"
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+
+// Read-ahead hints for the per-node and per-edge arrays of a mapped snapshot,
+// a tile at a time. RoadGraph numbers its nodes tile by tile, so the nodes of
+// a tile are a run of IDs and their entries in every array indexed by node
+// (or by edge, through a CSR offsets array) are a run of bytes in the file.
+// The kernel pages those bytes in as a search reads them; the prefetcher asks
+// for all of a tile's bytes at once (madvise WILLNEED) the first time a search
+// settles one of its nodes, so that a search crossing into a cold tile waits
+// for one read rather than a fault per page.
+//
+// It is only a hint. Nothing is ever let go or counted, and how much of the
+// snapshot stays in memory is up to the kernel; a tile is asked for once,
+// after which entering it costs a lookup. Arrays that are not views into a
+// mapped snapshot (a map parsed from text, or one that has been edited) are
+// left out; with none, or switched off, the prefetcher does nothing.
+
+    //the node IDs of the tile a search is in, [m_first, m_last); a search starts outside every tile
+struct TileCursor
+{
+    TileCursor() : m_first(0), m_last(0) {}
+    int m_first;
+    int m_last;
+};
+
+class TilePrefetcher
+{
+public:
+    TilePrefetcher();
+    ~TilePrefetcher();
+
+        //forgets the tiles and arrays, but not whether it is on
+    void clear();
+        //nodes of tile t are [firstNodes[t], firstNodes[t+1]); the prefetcher keeps the pointer
+    void setTiles(const FlatArray<int32_t>& firstNodes);
+        //array holds perNode elements for each node, or one for each edge with the edges of
+        //node n being [offsets[n], offsets[n+1]); arrays that are not views are left out
+    template<typename T>
+    void addNodeArray(const FlatArray<T>& array, size_t perNode = 1) { addRange(array.isView() ? array.data() : nullptr, sizeof(T) * perNode, nullptr); }
+    template<typename T>
+    void addEdgeArray(const FlatArray<T>& array, const FlatArray<int32_t>& offsets) { addRange(array.isView() && offsets.isView() ? array.data() : nullptr, sizeof(T), offsets.data()); }
+
+        //off to start with
+    void setEnabled(bool on);
+
+        //called by a search settling node outside cursor: sets cursor to node's tile, and
+        //asks for the tile the first time it is entered. Thread-safe
+    void enter(int node, TileCursor& cursor) const;
+
+      // We prevent a TilePrefetcher object from being copied or assigned.
+    TilePrefetcher(const TilePrefetcher&) = delete;
+    TilePrefetcher& operator=(const TilePrefetcher&) = delete;
+
+private:
+    struct Range {
+        const char*     m_base;
+        size_t          m_elemSize;
+        const int32_t*  m_offsets;          // nullptr for an array indexed by node
+    };
+
+    const int32_t* m_firstNodes;
+    int m_numTiles;
+    std::vector<Range> m_ranges;
+    bool m_on;
+    bool m_enabled;                         // on, with tiles, and mapped arrays to ask for
+    mutable std::unique_ptr<std::atomic<bool>[]> m_fetched;   // whether each tile has been asked for
+
+    /* private member functions */
+    void addRange(const void* base, size_t elemSize, const int32_t* offsets);
+    void prepare();                         //works out m_enabled and forgets what was asked for
+        //calls f(first, last) for the bytes of each array that tile t covers
+    template<typename F>
+    void forEachSpan(int t, F f) const;
+};
+
+#endif // TILEPREFETCHER_INCLUDED
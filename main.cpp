@@ -57,6 +57,37 @@
 //   34.0909630,-118.4030512 34.0909256,-118.4029338 east 0.0072 Stonewood Drive
 //   34.0909256,-118.4029338 34.0919749,-118.4018226 northeast 0.0964 Stonewood Drive
 //
+// To answer many queries with one map load, use batch mode:
+//  ./BruinNav theMapDataFileName -batch queryFile [-raw] [-stats] [-threads N] [-bidir|-ch|-alt] [-cache N] [-prefetch]
+// queryFile holds one "Start Attraction|End Attraction" pair per line (use -
+// to read the pairs from standard input). The pairs are routed concurrently
+// on N threads (default: one per core) sharing one Navigator, and the results
+// are printed in input order, each exactly as the single-query form would
+// print it (without the "Routing..." line). -bidir routes with bidirectional
+// A*, -ch with a contraction hierarchy and -alt with A* guided by landmarks
+// instead of plain A*; the routes have the same lengths. -cache N keeps the
+// directions of the N most recently used routes for repeated queries, and
+// prints the cache's counters at the end. -prefetch, for a map loaded from a
+// snapshot, asks for the snapshot's graph arrays a tile at a time as the
+// searches reach them (Navigator::setTilePrefetch).
+//
+// A start and end that are both written as "latitude,longitude", e.g.
+//  ./BruinNav mapdata.txt "34.0689,-118.4452" "34.0736,-118.4004"
+// route between those two positions instead of between attractions: each is
+// moved onto the nearest street, in either form, and must lie within a mile of one.
+//
+// To see which attractions match a partly typed name, use
+//  ./BruinNav mapdata.txt -complete "text" [k]
+// which prints up to k (default 10) names, best first, one per line: names
+// starting with the text, then names with a word starting with it, then names
+// holding it anywhere, then names within a typo or two of it.
+//
+// Adding -stats, in either form, follows each result with a line saying how
+// much work the search did and where the time went, for example
+//   Stats: settled 866 relaxed 1818 pushed 929 stale 12 peakheap 55 touched 917 lookup 0.004ms search 0.225ms reconstruct 0.002ms format 0.106ms
+// The counters are missing if the program was built with -DNAV_STATS=0, and a
+// route that came from the cache says "cache hit" instead.
+//
 // If you build the program as is, you'll notice the turn-by-turn instructions
 // say IN_SOME_DIRECTION instead of east or southwest or some actual direction.
 // That's because of the template appearing a few lines below; read the comment
@@ -65,9 +96,14 @@
 #include "provided.h"
 //#include "support.h"
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <string>
 #include <vector>
+#include <thread>
+#include <atomic>
 #include <cstring>
+#include <cstdlib>
 using namespace std;
 
 string directionOfLine(const GeoSegment& gs) {
@@ -96,22 +132,116 @@ string directionOfLine(const GeoSegment& gs) {
     return "";
 }
 
-void printDirectionsRaw(string start, string end, vector<NavSegment>& navSegments);
-void printDirections(string start, string end, vector<NavSegment>& navSegments);
+void printDirectionsRaw(string start, string end, vector<NavSegment>& navSegments, ostream& out = cout);
+void printDirections(string start, string end, vector<NavSegment>& navSegments, ostream& out = cout);
+void printResult(NavResult result, string start, string end, vector<NavSegment>& navSegments, bool raw, ostream& out);
+void printStats(const NavStats& stats, ostream& out);
+bool parseCoordinate(const string& text, GeoCoord& gc);
+NavResult navigateEither(const Navigator& nav, string start, string end, vector<NavSegment>& navSegments, NavStats& stats);
+int runBatch(const Navigator& nav, string queryFile, bool raw, bool stats, int numThreads);
 
 int main(int argc, char *argv[])
 {
+    if (argc >= 4  &&  strcmp(argv[2], "-batch") == 0)
+    {
+        bool raw = false;
+        bool stats = false;
+        SearchMode mode = SEARCH_ASTAR;
+        int cacheSize = 0;
+        bool prefetch = false;
+        int numThreads = thread::hardware_concurrency();
+        bool ok = true;
+        for (int i = 4; i < argc; i++)
+        {
+            if (strcmp(argv[i], "-raw") == 0)
+                raw = true;
+            else if (strcmp(argv[i], "-stats") == 0)
+                stats = true;
+            else if (strcmp(argv[i], "-threads") == 0  &&  i + 1 < argc  &&  atoi(argv[i+1]) > 0)
+                numThreads = atoi(argv[++i]);
+            else if (strcmp(argv[i], "-bidir") == 0)
+                mode = SEARCH_BIDIRECTIONAL;
+            else if (strcmp(argv[i], "-ch") == 0)
+                mode = SEARCH_CONTRACTION;
+            else if (strcmp(argv[i], "-alt") == 0)
+                mode = SEARCH_LANDMARKS;
+            else if (strcmp(argv[i], "-cache") == 0  &&  i + 1 < argc  &&  atoi(argv[i+1]) > 0)
+                cacheSize = atoi(argv[++i]);
+            else if (strcmp(argv[i], "-prefetch") == 0)
+                prefetch = true;
+            else
+                ok = false;
+        }
+        if ( ! ok)
+        {
+            cout << "Usage: BruinNav mapdata.txt -batch queryFile [-raw] [-stats] [-threads N] [-bidir|-ch|-alt] [-cache N] [-prefetch]" << endl;
+            return 1;
+        }
+        
+        Navigator nav;
+        
+        if ( ! nav.loadMapData(argv[1]))
+        {
+            cout << "Map data file was not found or has bad format: " << argv[1] << endl;
+            return 1;
+        }
+        
+        nav.setSearchMode(mode);
+        nav.setRouteCacheCapacity(cacheSize);
+        nav.setTilePrefetch(prefetch);
+        int status = runBatch(nav, argv[3], raw, stats, numThreads < 1 ? 1 : numThreads);
+        if (cacheSize > 0)
+        {
+            RouteCacheStats cacheStats = nav.getRouteCacheStats();
+            cerr << "Route cache: " << cacheStats.hits << " hits, " << cacheStats.misses << " misses, "
+                 << cacheStats.evictions << " evictions, " << cacheStats.size << "/" << cacheStats.capacity << " routes" << endl;
+        }
+        return status;
+    }
+    
+    if ((argc == 4  ||  argc == 5)  &&  strcmp(argv[2], "-complete") == 0)
+    {
+        int k = argc == 5 ? atoi(argv[4]) : 10;
+        if (k < 1)
+        {
+            cout << "Usage: BruinNav mapdata.txt -complete \"text\" [k]" << endl;
+            return 1;
+        }
+        
+        Navigator nav;
+        if ( ! nav.loadMapData(argv[1]))
+        {
+            cout << "Map data file was not found or has bad format: " << argv[1] << endl;
+            return 1;
+        }
+        
+        vector<string> names = nav.complete(argv[3], k);
+        for (size_t i = 0; i < names.size(); i++)
+            cout << names[i] << endl;
+        return 0;
+    }
+    
     bool raw = false;
-    if (argc == 5  &&  strcmp(argv[4], "-raw") == 0)
+    bool stats = false;
+    while (argc > 4)
     {
-        raw = true;
+        if (strcmp(argv[argc-1], "-raw") == 0  &&  ! raw)
+            raw = true;
+        else if (strcmp(argv[argc-1], "-stats") == 0  &&  ! stats)
+            stats = true;
+        else
+            break;
         argc--;
     }
     if (argc != 4)
     {
         cout << "Usage: BruinNav mapdata.txt \"start attraction\" \"end attraction name\"" << endl
         << "or" << endl
-        << "Usage: BruinNav mapdata.txt \"start attraction\" \"end attraction name\" -raw" << endl;
+        << "Usage: BruinNav mapdata.txt \"start attraction\" \"end attraction name\" [-raw] [-stats]" << endl
+        << "or" << endl
+        << "Usage: BruinNav mapdata.txt -batch queryFile [-raw] [-stats] [-threads N] [-bidir|-ch|-alt] [-cache N] [-prefetch]" << endl
+        << "or" << endl
+        << "Usage: BruinNav mapdata.txt -complete \"text\" [k]" << endl;
         return 1;
     }
     
@@ -130,42 +260,177 @@ int main(int argc, char *argv[])
     string end = argv[3];
     vector<NavSegment> navSegments;
     
-    NavResult result = nav.navigate(start, end, navSegments);
+    NavStats navStats;
+    NavResult result = navigateEither(nav, start, end, navSegments, navStats);
     if ( ! raw)
         cout << endl;
     
+    printResult(result, start, end, navSegments, raw, cout);
+    if (stats)
+        printStats(navStats, cout);
+}
+
+void printResult(NavResult result, string start, string end, vector<NavSegment>& navSegments, bool raw, ostream& out)
+{
     switch (result)
     {
         case NAV_NO_ROUTE:
-            cout << "No route found between " << start << " and " << end << endl;
+            out << "No route found between " << start << " and " << end << endl;
             break;
         case NAV_BAD_SOURCE:
-            cout << "Start attraction not found: " << start << endl;
+            out << "Start attraction not found: " << start << endl;
             break;
         case NAV_BAD_DESTINATION:
-            cout << "End attraction not found: " << end << endl;
+            out << "End attraction not found: " << end << endl;
             break;
         case NAV_SUCCESS:
             if (raw)
-                printDirectionsRaw(start, end, navSegments);
+                printDirectionsRaw(start, end, navSegments, out);
             else
-                printDirections(start, end, navSegments);
+                printDirections(start, end, navSegments, out);
             break;
     }
 }
 
-void printDirectionsRaw(string start, string end, vector<NavSegment>& navSegments)
+void printStats(const NavStats& stats, ostream& out)
+{
+    out << "Stats:";
+    if (stats.cacheHit)
+        out << " cache hit";
+    else if (stats.hasCounters)
+        out << " settled " << stats.nodesSettled << " relaxed " << stats.edgesRelaxed
+            << " pushed " << stats.heapPushes << " stale " << stats.stalePops
+            << " peakheap " << stats.peakHeapSize << " touched " << stats.nodesTouched;
+    out.setf(ios::fixed);
+    out.precision(3);
+    out << " lookup " << stats.lookupMs << "ms";
+    if ( ! stats.cacheHit)
+        out << " search " << stats.searchMs << "ms reconstruct " << stats.reconstructMs << "ms";
+    out << " format " << stats.formatMs << "ms" << endl;
+}
+
+bool parseCoordinate(const string& text, GeoCoord& gc)
+{
+    size_t comma = text.find(',');
+    if (comma == string::npos)
+        return false;
+    
+    string lat = text.substr(0, comma);
+    string lon = text.substr(comma + 1);
+    for (string* part : { &lat, &lon })
+    {
+        size_t first = part->find_first_not_of(" \t");
+        size_t last = part->find_last_not_of(" \t");
+        if (first == string::npos)
+            return false;
+        *part = part->substr(first, last - first + 1);
+        
+        char* stop;
+        strtod(part->c_str(), &stop);
+        if (*stop != '\0')
+            return false;
+    }
+    
+    gc = GeoCoord(lat, lon);
+    return true;
+}
+
+NavResult navigateEither(const Navigator& nav, string start, string end, vector<NavSegment>& navSegments, NavStats& stats)
+{
+    GeoCoord from, to;
+    if (parseCoordinate(start, from)  &&  parseCoordinate(end, to))
+        return nav.navigate(from, to, navSegments, stats);
+    return nav.navigate(start, end, navSegments, stats);
+}
+
+int runBatch(const Navigator& nav, string queryFile, bool raw, bool stats, int numThreads)
+{
+    ifstream infile;
+    if (queryFile != "-")
+    {
+        infile.open(queryFile);
+        if ( ! infile)
+        {
+            cout << "Query file was not found: " << queryFile << endl;
+            return 1;
+        }
+    }
+    istream& in = (queryFile == "-" ? cin : infile);
+    
+      // Queries are handled a block at a time: the workers route the block in
+      // parallel, each query into its own buffer, and the block is printed in
+      // input order before the next one is read.
+    const size_t blockSize = 1024;
+    vector<string> lines;
+    vector<string> results;
+    string line;
+    bool more = true;
+    
+    while (more)
+    {
+        lines.clear();
+        while (lines.size() < blockSize  &&  (more = static_cast<bool>(getline(in, line))))
+        {
+            if ( ! line.empty()  &&  line.back() == '\r')
+                line.pop_back();
+            if ( ! line.empty())
+                lines.push_back(line);
+        }
+        if (lines.empty())
+            break;
+        
+        results.assign(lines.size(), string());
+        atomic<size_t> next(0);
+        
+        auto worker = [&]()
+        {
+            vector<NavSegment> navSegments;
+            for (size_t i = next++; i < lines.size(); i = next++)
+            {
+                ostringstream out;
+                size_t bar = lines[i].find('|');
+                if (bar == string::npos)
+                    out << "Bad query (expected start|end): " << lines[i] << endl;
+                else
+                {
+                    string start = lines[i].substr(0, bar);
+                    string end = lines[i].substr(bar + 1);
+                    NavStats navStats;
+                    NavResult result = navigateEither(nav, start, end, navSegments, navStats);
+                    printResult(result, start, end, navSegments, raw, out);
+                    if (stats)
+                        printStats(navStats, out);
+                }
+                results[i] = out.str();
+            }
+        };
+        
+        vector<thread> workers;
+        for (int t = 1; t < numThreads  &&  static_cast<size_t>(t) < lines.size(); t++)
+            workers.push_back(thread(worker));
+        worker();
+        for (size_t t = 0; t < workers.size(); t++)
+            workers[t].join();
+        
+        for (size_t i = 0; i < results.size(); i++)
+            cout << results[i];
+    }
+    cout << flush;
+    return 0;
+}
+
+void printDirectionsRaw(string start, string end, vector<NavSegment>& navSegments, ostream& out)
 {
-    cout << "Start: " << start << endl;
-    cout << "End:   " << end << endl;
-    cout.setf(ios::fixed);
-    cout.precision(4);
+    out << "Start: " << start << endl;
+    out << "End:   " << end << endl;
+    out.setf(ios::fixed);
+    out.precision(4);
     for (auto ns : navSegments)
     {
         switch (ns.m_command)
         {
             case NavSegment::PROCEED:
-                cout << ns.m_geoSegment.start.latitudeText << ","
+                out << ns.m_geoSegment.start.latitudeText << ","
                 << ns.m_geoSegment.start.longitudeText << " "
                 << ns.m_geoSegment.end.latitudeText << ","
                 << ns.m_geoSegment.end.longitudeText << " "
@@ -174,18 +439,18 @@ void printDirectionsRaw(string start, string end, vector<NavSegment>& navSegment
                 << ns.m_streetName << endl;
                 break;
             case NavSegment::TURN:
-                cout << "turn " << ns.m_direction << " " << ns.m_streetName << endl;
+                out << "turn " << ns.m_direction << " " << ns.m_streetName << endl;
                 break;
         }
     }
 }
 
-void printDirections(string start, string end, vector<NavSegment>& navSegments)
+void printDirections(string start, string end, vector<NavSegment>& navSegments, ostream& out)
 {
-    cout.setf(ios::fixed);
-    cout.precision(2);
+    out.setf(ios::fixed);
+    out.precision(2);
     
-    cout << "You are starting at: " << start << endl;
+    out << "You are starting at: " << start << endl;
     
     double totalDistance = 0;
     string thisStreet;
@@ -209,22 +474,22 @@ void printDirections(string start, string end, vector<NavSegment>& navSegments)
             case NavSegment::TURN:
                 if (distSinceLastTurn > 0)
                 {
-                    cout << "Proceed " << distSinceLastTurn << " miles "
+                    out << "Proceed " << distSinceLastTurn << " miles "
                     << directionOfLine(effectiveSegment) << " on " << thisStreet << endl;
                     thisStreet.clear();
                     distSinceLastTurn = 0;
                 }
-                cout << "Turn " << ns.m_direction << " onto " << ns.m_streetName << endl;
+                out << "Turn " << ns.m_direction << " onto " << ns.m_streetName << endl;
                 break;
         }
     }
     
     if (distSinceLastTurn > 0)
-        cout << "Proceed " << distSinceLastTurn << " miles "
+        out << "Proceed " << distSinceLastTurn << " miles "
         << directionOfLine(effectiveSegment) << " on " << thisStreet << endl;
-    cout << "You have reached your destination: " << end << endl;
-    cout.precision(1);
-    cout << "Total travel distance: " << totalDistance << " miles" << endl;
+    out << "You have reached your destination: " << end << endl;
+    out.precision(1);
+    out << "Total travel distance: " << totalDistance << " miles" << endl;
 }
 
 /*
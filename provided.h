@@ -46,6 +46,13 @@ struct StreetSegment
 	std::vector<Attraction>	attractions;
 };
 
+struct FixedCoord;          // compact internal forms, defined in support.h
+struct SegmentRecord;
+struct AttractionRecord;
+struct MapTables;
+class MapSnapshot;          // see MapSnapshot.h
+class SnapshotWriter;
+
 class MapLoaderImpl;
 
 class MapLoader
@@ -56,6 +63,18 @@ public:
     bool load(std::string mapFile);
     size_t getNumSegments() const;
     bool getSegment(size_t segNum, StreetSegment& seg) const;
+      // The loaded map as flat internal records, without building StreetSegments.
+    const MapTables& getTables() const;
+      // The same, for editing the map in place (see MapTables); the snapshot, if any, is not changed.
+    MapTables& editTables();
+      // The snapshot the map was loaded from, or nullptr if it was parsed from text.
+    const MapSnapshot* getSnapshot() const;
+      // Number of record-aligned chunks load parses a text map in, at once; 0, the default, is
+      // one per core for maps of 256 KB and up, and 1 parses it in one piece. getParseChunks
+      // is the number the last load used: 1 if it fell back to parsing in one piece, 0 if it
+      // read a snapshot.
+    void setParseChunks(int chunks);
+    int getParseChunks() const;
       // We prevent a MapLoader object from being copied or assigned.
     MapLoader(const MapLoader&) = delete;
     MapLoader& operator=(const MapLoader&) = delete;
@@ -71,7 +90,21 @@ public:
     AttractionMapper();
     ~AttractionMapper();
     void init(const MapLoader& ml);
-    bool getGeoCoord(std::string attraction, GeoCoord& gc) const;
+    bool getGeoCoord(const std::string& attraction, GeoCoord& gc) const;
+    bool getGeoCoord(const std::string& attraction, FixedCoord& fc) const;
+        // Up to k attraction names matching text, ignoring case, best first: names starting
+        // with text, then names with a word starting with it, then names holding it anywhere,
+        // then names with a word starting within a typo or two of it (from 4 characters on, and
+        // with its first letter right or its first two swapped). Each group is in alphabetical
+        // order except the last, which puts closer matches first.
+    std::vector<std::string> complete(const std::string& text, size_t k) const;
+        // ID of the segment the attraction is on, or -1 if there is no such attraction
+    int getSegmentId(const std::string& attraction) const;
+        // Edits, made in place at a cost that does not grow with the map; save writes the map as
+        // it was built, without them. An added attraction replaces any other of that name.
+    void addAttraction(const std::string& name, const FixedCoord& fc, int segment);
+    bool removeAttraction(const std::string& name);     // false if there is no such attraction
+    void save(SnapshotWriter& w) const;
       // We prevent an AttractionMapper object from being copied or assigned.
     AttractionMapper(const AttractionMapper&) = delete;
     AttractionMapper& operator=(const AttractionMapper&) = delete;
@@ -79,15 +112,47 @@ private:
     AttractionMapperImpl* m_impl;
 };
 
+  // A read-only run of segment IDs, valid for as long as the SegmentMapper is unchanged
+struct SegmentIdRange
+{
+    SegmentIdRange() : m_first(nullptr), m_last(nullptr) {}
+    SegmentIdRange(const int* first, const int* last) : m_first(first), m_last(last) {}
+
+    const int* begin() const { return m_first; }
+    const int* end() const { return m_last; }
+    size_t size() const { return m_last - m_first; }
+    bool empty() const { return m_first == m_last; }
+    int operator[](size_t i) const { return m_first[i]; }
+
+    const int* m_first;
+    const int* m_last;
+};
+
 class SegmentMapperImpl;
 
+  // A standalone index from coordinates to the segments that start, end or have an
+  // attraction there. Navigator does not use it (it routes over RoadGraph and snaps
+  // coordinates with SpatialIndex), so a Navigator's edits are not seen here.
 class SegmentMapper
 {
 public:
     SegmentMapper();
     ~SegmentMapper();
+      // Refers to ml's segments rather than copying them, so ml must outlive the mapper and
+      // must not be edited while it is in use.
     void init(const MapLoader& ml);
     std::vector<StreetSegment> getSegments(const GeoCoord& gc) const;
+      // Zero-copy access: IDs of the segments associated with a coordinate, and each segment's
+      // record, with its street name ID (in the MapLoader's name table), its ends as
+      // FixedCoords and the run of its attractions' records. None of these copy or allocate;
+      // getSegment builds the StreetSegment for an ID, strings and all.
+    SegmentIdRange getSegmentIds(const GeoCoord& gc) const;
+    SegmentIdRange getSegmentIds(const FixedCoord& fc) const;
+    const SegmentRecord& getSegmentRecord(int segId) const;
+    const AttractionRecord& getAttractionRecord(int index) const;   // index from SegmentRecord::firstAttraction on
+    StreetSegment getSegment(int segId) const;
+    int getStreetNameId(int segId) const;   // same as getSegmentRecord(segId).name
+    size_t getNumSegments() const;
       // We prevent a SegmentMapper object from being copied or assigned.
     SegmentMapper(const SegmentMapper&) = delete;
     SegmentMapper& operator=(const SegmentMapper&) = delete;
@@ -125,6 +190,50 @@ enum NavResult {
 	NAV_SUCCESS, NAV_BAD_SOURCE, NAV_BAD_DESTINATION, NAV_NO_ROUTE
 };
 
+    // Route search used by Navigator::navigate; all modes find routes of the same length.
+enum SearchMode {
+	SEARCH_ASTAR,               // A* from the start (the default)
+	SEARCH_BIDIRECTIONAL,       // A* from both ends at once, meeting in the middle
+	SEARCH_CONTRACTION,         // contraction hierarchy; prepared when first selected unless the snapshot has one
+	SEARCH_LANDMARKS            // A* with landmark lower bounds (ALT); prepared the same way
+};
+
+    // Priority queue the searches use as their open list (see OpenList.h). All give routes
+    // of the same length; they differ in speed.
+enum QueueKind {
+	QUEUE_BINARY,               // binary heap; a lowered key queues the node again
+	QUEUE_QUATERNARY,           // indexed 4-ary heap; a lowered key moves the node in place (the default)
+	QUEUE_RADIX                 // radix heap, relying on the keys never decreasing
+};
+
+    // What one call of Navigator::navigate did. The counters add up the forward and
+    // backward searches of the modes that have both, and are zero when the program is
+    // built with -DNAV_STATS=0, which compiles the counting out of the searches.
+struct NavStats {
+	bool cacheHit;              // the directions came from the route cache; no search ran
+	bool hasCounters;           // false if the counting was compiled out
+	size_t nodesSettled;
+	size_t edgesRelaxed;
+	size_t heapPushes;
+	size_t stalePops;           // heap entries skipped because their node was settled already
+	size_t peakHeapSize;
+	size_t nodesTouched;        // distinct nodes given a tentative distance
+	double lookupMs;            // attraction names (or snapped coordinates) to graph nodes
+	double searchMs;
+	double reconstructMs;       // piecing the path together from the search, unpacking shortcuts
+	double formatMs;            // building the NavSegments
+	SearchMode searchedWith;    // the search that ran: the mode selected, unless it fell back (see isSearchDegraded)
+};
+
+    // Counters of Navigator's route cache (see Navigator::setRouteCacheCapacity).
+struct RouteCacheStats {
+	size_t hits;
+	size_t misses;
+	size_t evictions;
+	size_t size;                // routes held now
+	size_t capacity;
+};
+
 class NavigatorImpl;
 
 class Navigator
@@ -133,7 +242,77 @@ public:
     Navigator();
     ~Navigator();
     bool loadMapData(std::string mapFile);
+        // Number of threads loadMapData builds the map's indexes on; 1, the default, builds them
+        // one after another, and 0 is one per core. Building them at once holds all their
+        // temporaries at once: on a 68 MB map, 3 threads raise the peak memory of a load from
+        // 214 MB to 312 MB, to save at most the 190 ms the street grid and attraction index
+        // take beside the 340 ms road graph build.
+    void setBuildThreads(int threads);
+        // navigate may be called concurrently from any number of threads, as long as
+        // no thread is calling loadMapData at the same time; each thread searches in
+        // its own reusable workspace (see SearchWorkspace.h).
     NavResult navigate(std::string start, std::string end, std::vector<NavSegment>& directions) const;
+    NavResult navigate(std::string start, std::string end, std::vector<NavSegment>& directions, NavStats& stats) const;
+        // Routes between two arbitrary positions, such as GPS fixes, using their latitude and
+        // longitude numbers (not the text). Each is moved onto the nearest point of the nearest
+        // street, and the directions run from and to those points. NAV_BAD_SOURCE or
+        // NAV_BAD_DESTINATION means the position is not a valid coordinate, or is farther than
+        // the maximum snap distance from every street.
+    NavResult navigate(const GeoCoord& start, const GeoCoord& end, std::vector<NavSegment>& directions) const;
+    NavResult navigate(const GeoCoord& start, const GeoCoord& end, std::vector<NavSegment>& directions, NavStats& stats) const;
+        // Up to k attraction names for a partly typed name, best first (see AttractionMapper::complete)
+    std::vector<std::string> complete(const std::string& text, size_t k) const;
+        // Sets matrix[i][j] to the length in miles of the shortest route from sources[i] to
+        // targets[j], or to -1 if either is not an attraction or there is no route. No
+        // directions are built. The sources are shared out among numThreads threads
+        // (0 means one per core); like navigate, it may run alongside other queries.
+    void distanceMatrix(const std::vector<std::string>& sources, const std::vector<std::string>& targets,
+                        std::vector<std::vector<double>>& matrix, int numThreads = 0) const;
+        // Keeps the directions of up to routes recently navigated routes, keyed on the places the
+        // names resolve to, and reuses them for repeated queries; 0 (the default) turns it off.
+        // Loading a map or changing the search mode empties the cache.
+    void setRouteCacheCapacity(size_t routes);
+    RouteCacheStats getRouteCacheStats() const;
+        // like loadMapData, must not be called while other threads are navigating. Selecting
+        // SEARCH_CONTRACTION or SEARCH_LANDMARKS may take a moment, to prepare their tables
+    void setSearchMode(SearchMode mode);
+        // Selects the open list of the searches (QUEUE_QUATERNARY by default); same rules as setSearchMode
+    void setQueueKind(QueueKind kind);
+        // Read-ahead for a mapped snapshot's graph arrays: when a search first reaches a tile of
+        // the map, the tile's nodes and edges (and the hierarchy's and landmarks' tables, when
+        // they come from the snapshot) are asked of the operating system at once (see
+        // TilePrefetcher.h). It is only a hint: it neither bounds nor measures the memory the
+        // map takes, and does nothing for a map read from text. Off by default. Same rules as
+        // setSearchMode.
+    void setTilePrefetch(bool on);
+        // How far, in miles, a coordinate given to navigate may lie from the street it is moved
+        // onto; defaultMaxSnapMiles until set.
+    static constexpr double defaultMaxSnapMiles = 1.0;
+    void setMaxSnapDistance(double miles);
+        // Edits to the loaded map, such as road closures, made in place without reloading it.
+        // A segment is named by its street name and its two ends, either way round. Each
+        // costs about as much as the part of the map it touches (the first edit to a map
+        // loaded from a snapshot also copies out the arrays it changes). Like loadMapData,
+        // they must not be called while other threads are navigating. They drop the cached
+        // routes they may have changed. Roads added or reopened are put into the tables of
+        // SEARCH_CONTRACTION and SEARCH_LANDMARKS in place. Across removals and closures the
+        // landmarks stay as they are, and the hierarchy's routes are checked against the
+        // edited map: one that runs over a removed or closed road is searched again
+        // bidirectionally, and distanceMatrix does without the hierarchy, until setSearchMode
+        // rebuilds it (see isSearchDegraded). An added attraction replaces any other of its
+        // name. Each returns false if the segment is not on the map (or, for removeAttraction,
+        // there is no such attraction) or a coordinate is not valid.
+    bool addSegment(const StreetSegment& seg);
+    bool removeSegment(const StreetSegment& seg);       // for good; its attractions go with it
+    bool setSegmentOpen(const StreetSegment& seg, bool open);   // a closed segment stays on the map, unused
+    bool addAttraction(const StreetSegment& seg, const Attraction& att);
+    bool removeAttraction(const std::string& name);
+        // True if the search mode selected cannot answer every route by itself: in
+        // SEARCH_CONTRACTION after a road was removed or closed since the hierarchy was built
+        // (or if the map was empty then), and in SEARCH_LANDMARKS if the map was empty. Routes
+        // the mode cannot answer fall back as NavStats::searchedWith shows; selecting the
+        // mode again with setSearchMode prepares it for the map as edited.
+    bool isSearchDegraded() const;
       // We prevent a Navigator object from being copied or assigned.
     Navigator(const Navigator&) = delete;
     Navigator& operator=(const Navigator&) = delete;
@@ -1,6 +1,11 @@
 #include "support.h"
 #include "provided.h"
 #include <string>
+#include <cstring>
+#include <cctype>
+#include <cmath>
+#include <algorithm>
+using namespace std;
 
 bool operator<(const GeoCoord& a, const GeoCoord& b) {
     
@@ -23,4 +28,236 @@ bool operator<(const GeoCoord& a, const GeoCoord& b) {
 
 bool operator==(const GeoCoord& a, const GeoCoord& b) {
     return a.latitudeText == b.latitudeText && a.longitudeText == b.longitudeText;
-}
\ No newline at end of file
+}
+
+size_t std::hash<GeoCoord>::operator()(const GeoCoord& gc) const {
+    
+    //Equal coordinate text always parses to equal doubles, so hashing the bits
+    //of the doubles is consistent with operator==
+    
+    unsigned long long lat, lon;
+    memcpy(&lat, &gc.latitude, sizeof(lat));
+    memcpy(&lon, &gc.longitude, sizeof(lon));
+    
+    return static_cast<size_t>(lat ^ (lon * 0x9E3779B97F4A7C15ULL) ^ (lon >> 29));
+}
+
+const char* parseFixed(const char* first, const char* last, int32_t& value) {
+    
+    const char* p = first;
+    while (p != last && (*p == ' ' || *p == '\t'))
+        p++;
+    
+    bool negative = false;
+    if (p != last && (*p == '-' || *p == '+'))
+        negative = (*p++ == '-');
+    
+    const char* digits = p;
+    long long result = 0;
+    
+    for (; p != last && static_cast<unsigned>(*p - '0') < 10; p++) {    //whole degrees
+        result = result * 10 + (*p - '0');
+        if (result > 1000)                              //no valid degree value gets this big
+            return nullptr;
+    }
+    bool anyDigits = (p != digits);
+    
+    int decimals = 0;
+    if (p != last && *p == '.') {
+        
+        for (p++; p != last && static_cast<unsigned>(*p - '0') < 10 && decimals < 7; p++, decimals++)
+            result = result * 10 + (*p - '0');
+        anyDigits = anyDigits || decimals > 0;
+        
+        if (p != last && static_cast<unsigned>(*p - '0') < 10) {      //beyond our precision, round on the first dropped digit
+            if (*p >= '5')
+                result++;
+            while (p != last && static_cast<unsigned>(*p - '0') < 10)
+                p++;
+        }
+    }
+    
+    if (!anyDigits)
+        return nullptr;
+    
+    static const long long scale[8] = { 10000000, 1000000, 100000, 10000, 1000, 100, 10, 1 };
+    result *= scale[decimals];
+    
+    if (result > 2147483647LL)                          //does not fit in 32 bits
+        return nullptr;
+    
+    value = static_cast<int32_t>(negative ? -result : result);
+    return p;
+}
+
+bool parseFixed(const string& text, int32_t& value) {
+    
+    size_t i = 0;
+    while (i < text.size() && isspace(static_cast<unsigned char>(text[i])))
+        i++;
+    
+    return parseFixed(text.data() + i, text.data() + text.size(), value) != nullptr;
+}
+
+string fixedToText(int32_t value) {
+    
+    char buf[16];
+    long long v = value;
+    bool negative = v < 0;
+    if (negative)
+        v = -v;
+    
+    char* p = buf + sizeof(buf);
+    for (int d = 0; d < 7; d++) {                       //seven decimal digits
+        *--p = '0' + v % 10;
+        v /= 10;
+    }
+    *--p = '.';
+    do {
+        *--p = '0' + v % 10;
+        v /= 10;
+    } while (v != 0);
+    if (negative)
+        *--p = '-';
+    
+    return string(p, buf + sizeof(buf));
+}
+
+FixedCoord toFixed(const GeoCoord& gc) {
+    
+    FixedCoord fc;
+    if (!parseFixed(gc.latitudeText, fc.lat))
+        fc.lat = static_cast<int32_t>(llround(gc.latitude * 1e7));
+    if (!parseFixed(gc.longitudeText, fc.lon))
+        fc.lon = static_cast<int32_t>(llround(gc.longitude * 1e7));
+    return fc;
+}
+
+GeoCoord toGeoCoord(const FixedCoord& fc) {
+    
+    GeoCoord gc;
+    gc.latitudeText = fixedToText(fc.lat);
+    gc.longitudeText = fixedToText(fc.lon);
+    gc.latitude = fc.latitude();
+    gc.longitude = fc.longitude();
+    return gc;
+}
+
+void DistanceBound::init(const FixedCoord& lo, const FixedCoord& hi) {
+    
+    const double milesPerRadian = 6371.0 * 0.621371;   //the earth's radius as distanceEarthMiles has it
+    const double radiansPerUnit = deg2rad(1e-7);
+    const double rounding = 1 - 1e-9;                   //covers the rounding in both formulas
+    
+        //sin(x)/x is decreasing on [0, pi/2], so its value at half the larger extent bounds both terms
+    double halfExtent = max(static_cast<double>(hi.lat) - lo.lat, static_cast<double>(hi.lon) - lo.lon) * radiansPerUnit / 2;
+    const double halfPi = 1.57079632679489661923;
+    double sinc = 1;
+    if (halfExtent >= halfPi)
+        sinc = 0;                           //a box this large gets no useful bound
+    else if (halfExtent > 0)
+        sinc = sin(halfExtent) / halfExtent;
+    
+    double poleward = max(fabs(static_cast<double>(lo.lat)), fabs(static_cast<double>(hi.lat))) * radiansPerUnit;
+    
+    m_latScale = milesPerRadian * radiansPerUnit * sinc * rounding;
+    m_lonScale = m_latScale * max(cos(poleward), 0.0);
+}
+
+void NameTable::build(const vector<string>& names) {
+    
+    vector<char> chars;
+    vector<int32_t> offsets;
+    
+    offsets.push_back(0);
+    for (size_t i = 0; i < names.size(); i++) {
+        chars.insert(chars.end(), names[i].begin(), names[i].end());
+        offsets.push_back(static_cast<int32_t>(chars.size()));
+    }
+    
+    m_chars.adopt(chars);
+    m_offsets.adopt(offsets);
+}
+
+int NameTable::add(const string& name) {
+    
+    if (m_offsets.empty())
+        m_offsets.push_back(0);
+    for (size_t i = 0; i < name.size(); i++)
+        m_chars.push_back(name[i]);
+    m_offsets.push_back(static_cast<int32_t>(m_chars.size()));
+    return size() - 1;
+}
+
+void buildStreetSegment(const MapTables& tables, size_t segNum, StreetSegment& seg) {
+    
+    const SegmentRecord& rec = tables.segments[segNum];
+    
+    seg.streetName = tables.names.get(rec.name);
+    seg.segment = GeoSegment(tables.numberTexts.geoCoord(rec.start), tables.numberTexts.geoCoord(rec.end));
+    seg.attractions.clear();
+    
+    for (int i = 0; i < rec.numAttractions; i++) {
+        const AttractionRecord& ar = tables.attractions[rec.firstAttraction + i];
+        Attraction att;
+        att.name = tables.names.get(ar.name);
+        att.geocoordinates = tables.numberTexts.geoCoord(ar.coord);
+        seg.attractions.push_back(att);
+    }
+}
+
+void NumberTexts::build(vector<pair<int32_t, string>>& texts) {
+    
+    stable_sort(texts.begin(), texts.end(), [](const pair<int32_t, string>& a, const pair<int32_t, string>& b) {
+        return a.first < b.first;
+    });
+    
+    vector<int32_t> values;
+    vector<string> strings;
+    for (size_t i = 0; i < texts.size(); i++)
+        if (values.empty() || values.back() != texts[i].first) {
+            values.push_back(texts[i].first);
+            strings.push_back(texts[i].second);
+        }
+    
+    m_values.adopt(values);
+    m_texts.build(strings);
+}
+
+void NumberTexts::copy(const NumberTexts& other) {
+    m_values.assign(other.m_values.data(), other.m_values.size());
+    m_texts.m_chars.assign(other.m_texts.m_chars.data(), other.m_texts.m_chars.size());
+    m_texts.m_offsets.assign(other.m_texts.m_offsets.data(), other.m_texts.m_offsets.size());
+}
+
+string NumberTexts::text(int32_t value) const {
+    
+    if (m_values.empty())
+        return fixedToText(value);
+    
+    const int32_t* it = lower_bound(m_values.begin(), m_values.end(), value);
+    if (it == m_values.end() || *it != value)
+        return fixedToText(value);
+    return m_texts.get(static_cast<int>(it - m_values.begin()));
+}
+
+GeoCoord NumberTexts::geoCoord(const FixedCoord& fc) const {
+    
+    if (m_values.empty())
+        return toGeoCoord(fc);
+    return GeoCoord(text(fc.lat), text(fc.lon));    //the doubles std::stod gives for the text, as ever
+}
+
+int NameTable::compare(int id, const string& s) const {
+    
+    size_t len = length(id);
+    int result = memcmp(data(id), s.data(), min(len, s.size()));
+    
+    if (result != 0)
+        return result;
+    if (len < s.size())
+        return -1;
+    if (len > s.size())
+        return 1;
+    return 0;
+}
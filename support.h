@@ -2,8 +2,265 @@
 #define support_h
 
 #include "provided.h"
+#include "MyMap.h"
+#include <functional>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cmath>
 
 bool operator<(const GeoCoord& a, const GeoCoord& b);
+    //compares the text, so "-118.40" and "-118.4000000" differ here, although the mappers and
+    //Navigator, which look places up by FixedCoord, take them for the same point
 bool operator==(const GeoCoord& a, const GeoCoord& b);
 
+namespace std {
+    template<>
+    struct hash<GeoCoord> {         //lets GeoCoord be used as a MyMap key
+        size_t operator()(const GeoCoord& gc) const;
+    };
+}
+
+// Compact coordinate used inside the loader, the mappers and the search.
+// Latitude and longitude are stored as integer multiples of 1e-7 degrees,
+// which is exactly the precision mapdata.txt is written in. parseFixed takes
+// any number of decimals (and a '+'), rounding past the seventh, and
+// fixedToText always writes seven; MapLoader keeps the text of the numbers
+// it was given any other way in a NumberTexts, so the original text can still
+// be reproduced digit for digit when a GeoCoord is handed back out.
+
+struct FixedCoord
+{
+    int32_t lat;
+    int32_t lon;
+
+    double latitude() const { return lat / 1e7; }      //same double std::stod gives for the text
+    double longitude() const { return lon / 1e7; }
+};
+
+inline bool operator==(const FixedCoord& a, const FixedCoord& b) { return a.lat == b.lat && a.lon == b.lon; }
+inline bool operator!=(const FixedCoord& a, const FixedCoord& b) { return !(a == b); }
+
+namespace std {
+    template<>
+    struct hash<FixedCoord> {
+        size_t operator()(const FixedCoord& fc) const {
+            return static_cast<size_t>((static_cast<uint64_t>(static_cast<uint32_t>(fc.lat)) << 32) | static_cast<uint32_t>(fc.lon));
+        }
+    };
+}
+
+    //parses decimal degree text such as "-118.4794734"; returns false if text is not a number
+bool parseFixed(const std::string& text, int32_t& value);
+    //same, for the text starting at first (after any blanks); returns the end of the number, or nullptr
+const char* parseFixed(const char* first, const char* last, int32_t& value);
+std::string fixedToText(int32_t value);
+
+FixedCoord toFixed(const GeoCoord& gc);
+GeoCoord toGeoCoord(const FixedCoord& fc);          //rebuilds the text form
+
+inline double distanceEarthMiles(const FixedCoord& f1, const FixedCoord& f2) {
+	static const double earthRadiusKm = 6371.0;
+	const double milesPerKm = 0.621371;
+	double lat1r = deg2rad(f1.latitude());
+	double lon1r = deg2rad(f1.longitude());
+	double lat2r = deg2rad(f2.latitude());
+	double lon2r = deg2rad(f2.longitude());
+	double u = std::sin((lat2r - lat1r) / 2);
+	double v = std::sin((lon2r - lon1r) / 2);
+	return 2.0 * earthRadiusKm * std::asin(std::sqrt(u * u + std::cos(lat1r) * std::cos(lat2r) * v * v)) * milesPerKm;
+}
+
+// A lower bound on distanceEarthMiles between any two points inside a
+// latitude/longitude box, computed without trigonometry: the coordinate
+// differences are scaled to miles with the cosine of the box's most poleward
+// latitude, and the whole is shrunk a little so that it never overestimates.
+// In the haversine formula d = 2R asin(sqrt(sin^2(dLat/2) + cos(lat1) cos(lat2) sin^2(dLon/2))),
+// asin(x) >= x, sin(x) >= x sin(X)/X for 0 <= x <= X (X being half the box's
+// extent), and each cosine is at least the cosine at that poleward edge, which
+// together give d >= R s sqrt(dLat^2 + (c dLon)^2).
+// Being a scaled norm of the coordinate difference, the bound also satisfies
+// the triangle inequality, so as an A* heuristic it is consistent as well as
+// admissible.
+
+class DistanceBound
+{
+public:
+    DistanceBound() : m_latScale(0), m_lonScale(0) {}   //bounds every distance by 0 until init
+
+        //prepares the bound for points with lo.lat <= lat <= hi.lat and lo.lon <= lon <= hi.lon
+    void init(const FixedCoord& lo, const FixedCoord& hi);
+
+    double miles(const FixedCoord& f1, const FixedCoord& f2) const {
+        double dLat = (f1.lat - f2.lat) * m_latScale;
+        double dLon = (f1.lon - f2.lon) * m_lonScale;
+        return std::sqrt(dLat * dLat + dLon * dLon);
+    }
+
+private:
+    double m_latScale;                      // miles per FixedCoord unit of latitude, shrunk
+    double m_lonScale;                      // ... and of longitude at the poleward edge
+};
+
+    //angleOfLine of the segment from f1 to f2: degrees counterclockwise from east, in [0, 360)
+inline double angleOfLine(const FixedCoord& f1, const FixedCoord& f2) {
+	double result = rad2deg(atan2(f2.latitude() - f1.latitude(), f2.longitude() - f1.longitude()));
+	if (result < 0)
+		result += 360;
+
+	return result;
+}
+
+// An array that either owns its elements or views memory owned elsewhere,
+// such as a mapped snapshot file (see MapSnapshot.h). It is read-only except
+// through edit and push_back, which first copy a view into storage of its own;
+// both may move the elements, so pointers into the array do not survive them.
+
+template<typename T>
+class FlatArray
+{
+public:
+    FlatArray() : m_data(nullptr), m_size(0) {}
+
+        //takes the contents of v, leaving v empty
+    void adopt(std::vector<T>& v) { m_owned.swap(v); v.clear(); m_data = m_owned.data(); m_size = m_owned.size(); }
+    void view(const T* data, size_t size) { m_owned.clear(); m_data = data; m_size = size; }
+        //copies size elements starting at data into storage of its own
+    void assign(const T* data, size_t size) { std::vector<T> v(data, data + size); adopt(v); }
+    void clear() { m_owned.clear(); m_data = nullptr; m_size = 0; }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    const T* data() const { return m_data; }
+    const T* begin() const { return m_data; }
+    const T* end() const { return m_data + m_size; }
+    const T& operator[](size_t i) const { return m_data[i]; }
+
+    bool isView() const { return m_data != m_owned.data(); }    //false if empty
+    T& edit(size_t i) { own(); return m_owned[i]; }
+    void push_back(const T& value) { own(); m_owned.push_back(value); m_data = m_owned.data(); m_size = m_owned.size(); }
+
+      // We prevent a FlatArray object from being copied or assigned; a copy would point into the original.
+    FlatArray(const FlatArray&) = delete;
+    FlatArray& operator=(const FlatArray&) = delete;
+
+private:
+    std::vector<T> m_owned;
+    const T* m_data;
+    size_t m_size;
+
+    /* private member functions */
+    void own() { if (isView()) { std::vector<T> v(m_data, m_data + m_size); adopt(v); } }
+};
+
+// A pool of strings addressed by dense integer IDs, stored as one character
+// blob plus an offset array so that it can live in a snapshot.
+
+class NameTable
+{
+public:
+    void build(const std::vector<std::string>& names);
+    void clear() { m_chars.clear(); m_offsets.clear(); }
+
+    int size() const { return m_offsets.empty() ? 0 : static_cast<int>(m_offsets.size()) - 1; }
+    const char* data(int id) const { return m_chars.data() + m_offsets[id]; }
+    size_t length(int id) const { return m_offsets[id+1] - m_offsets[id]; }
+    std::string get(int id) const { return std::string(data(id), length(id)); }
+        //appends name, returning its ID
+    int add(const std::string& name);
+
+        //three-way comparison of name id against s, like std::string::compare
+    int compare(int id, const std::string& s) const;
+
+    FlatArray<char> m_chars;
+    FlatArray<int32_t> m_offsets;           // size()+1 entries
+};
+
+// The text of the coordinate numbers a map file wrote otherwise than fixedToText
+// would (with other than seven decimals, say), keyed by their value. Empty for a
+// file like mapdata.txt; where one value was written several ways, the first wins.
+
+class NumberTexts
+{
+public:
+        //texts holds (value, text) pairs in file order; it is left in no particular order
+    void build(std::vector<std::pair<int32_t, std::string>>& texts);
+    void clear() { m_values.clear(); m_texts.clear(); }
+    void copy(const NumberTexts& other);
+
+        //the text value was written with, or fixedToText's
+    std::string text(int32_t value) const;
+        //like toGeoCoord, with the text fc's numbers were written with
+    GeoCoord geoCoord(const FixedCoord& fc) const;
+
+    FlatArray<int32_t> m_values;            // sorted
+    NameTable m_texts;                      // m_texts.get(i) is the text of m_values[i]
+};
+
+// Internal form of the map as MapLoader stores it: flat records that refer to
+// each other and to the name table by index.
+
+struct SegmentRecord
+{
+    int32_t     name;                       // street name ID
+    FixedCoord  start;
+    FixedCoord  end;
+    int32_t     firstAttraction;            // attractions are [firstAttraction, firstAttraction+numAttractions)
+    int32_t     numAttractions;
+};
+
+struct AttractionRecord
+{
+    int32_t     name;                       // attraction name ID
+    FixedCoord  coord;
+};
+
+class MapSnapshot;
+class SnapshotWriter;
+
+struct MapTables
+{
+    FlatArray<SegmentRecord>    segments;
+    FlatArray<AttractionRecord> attractions;
+    NameTable                   names;
+    NumberTexts                 numberTexts;
+    MyMap<std::string, int>     nameIds;    // name -> ID, filled in by the first intern
+
+    void clear() { segments.clear(); attractions.clear(); names.clear(); numberTexts.clear(); nameIds.clear(); }
+        //views other's records instead of copying them, so other must outlive this and not be
+        //edited meanwhile; edits made here copy the records first
+    void share(const MapTables& other);
+    void save(SnapshotWriter& w) const;
+    bool load(const MapSnapshot& snap);
+
+        // Edits, for changing a loaded map in place. Segment IDs never change: a segment
+        // is only ever added at the end.
+        //ID of name, adding it to the table if it is new
+    int intern(const std::string& name);
+        //returns the new segment's ID; it has no attractions
+    int addSegment(int name, const FixedCoord& start, const FixedCoord& end);
+        //moves segment's attractions to the end of the table, unless they are there already,
+        //so that the new one can follow them
+    void addAttraction(int segment, int name, const FixedCoord& coord);
+        //removes the index'th of segment's attractions
+    void removeAttraction(int segment, int index);
+};
+
+    //builds the public form of segment segNum, materializing its names and coordinate text
+void buildStreetSegment(const MapTables& tables, size_t segNum, StreetSegment& seg);
+
+// Where a route starts or ends. An attraction is a node of the road graph; a
+// coordinate snapped onto a street lies between the two ends of its segment,
+// and a route leaves it (or reaches it) by either one. The searches start
+// from all of a RouteEnd's nodes at once, each at its distance from the point.
+
+struct RouteEnd
+{
+    FixedCoord  coord;                      // the point itself
+    int32_t     segment;                    // segment it was snapped onto, -1 if it is a node
+    int32_t     numNodes;                   // 1 or 2
+    int32_t     nodes[2];                   // RoadGraph node IDs
+    double      dists[2];                   // miles between each node and the point
+};
+
 #endif /* support_h */
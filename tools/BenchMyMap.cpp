@@ -0,0 +1,267 @@
+// This is the MyMap benchmark. It compares MyMap (MyMap.h) with the unbalanced
+// binary search tree it replaced, a copy of which is kept below as TreeMap, on
+// the keys the loader and the mappers use: the segment endpoints of a map as
+// GeoCoords, in file order, and its street names, which arrive sorted.
+//  ./bench_mymap mapdata.txt [-rounds N] [-csv]
+// prints JSON with, for each kind of key and each map, the time to associate
+// every key in file order and the time to find each of them N more times
+// (default 10). -csv prints one "metric,value" line per number instead. Build
+// it from the top-level directory with every .cpp except main.cpp, e.g.
+//  g++ -std=c++17 -O2 -pthread -I. -o bench_mymap tools/BenchMyMap.cpp $(ls *.cpp | grep -v main.cpp)
+
+#include "provided.h"
+#include "MyMap.h"
+#include "support.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+using namespace std;
+
+namespace {
+
+// MyMap as it was before it became a hash table: an unbalanced binary search
+// tree, recursive throughout, kept here unchanged apart from its name.
+
+template<typename KeyType, typename ValueType>
+class TreeMap
+{
+public:
+	TreeMap();
+	~TreeMap();
+	void clear();
+	int size() const;
+	void associate(const KeyType& key, const ValueType& value);
+
+	  // for a map that can't be modified, return a pointer to const ValueType
+	const ValueType* find(const KeyType& key) const;
+
+	  // for a modifiable map, return a pointer to modifiable ValueType
+	ValueType* find(const KeyType& key)
+	{
+		return const_cast<ValueType*>(const_cast<const TreeMap*>(this)->find(key));
+	}
+
+	  // C++11 syntax for preventing copying and assignment
+	TreeMap(const TreeMap&) = delete;
+	TreeMap& operator=(const TreeMap&) = delete;
+
+private:
+
+    struct Node {
+
+        Node(KeyType key, ValueType val, Node* left, Node* right)
+         : m_key(key), m_val(val), m_left(left), m_right(right)
+        {}
+
+        KeyType m_key;
+        ValueType m_val;
+        Node* m_left;
+        Node* m_right;
+    };
+
+    int m_size;
+    Node* m_root;
+
+    /* private member functions */
+    void clearAux(Node* &root);
+    void associateAux(const KeyType& key, const ValueType& value, Node* &root);
+    ValueType* findAux(const KeyType& key, Node* root) const;
+};
+
+template<typename KeyType, typename ValueType>
+TreeMap<KeyType, ValueType>::TreeMap() : m_size(0), m_root(nullptr) {}
+
+template<typename KeyType, typename ValueType>
+TreeMap<KeyType, ValueType>::~TreeMap() {
+    clear();
+}
+
+template<typename KeyType, typename ValueType>
+void TreeMap<KeyType, ValueType>::clear() {
+    clearAux(m_root);
+    m_size=0;
+}
+
+template<typename KeyType, typename ValueType>
+int TreeMap<KeyType, ValueType>::size() const { return m_size; }
+
+template<typename KeyType, typename ValueType>
+void TreeMap<KeyType, ValueType>::associate(const KeyType &key, const ValueType &value) {
+    associateAux(key, value, m_root);
+}
+
+template<typename KeyType, typename ValueType>
+const ValueType* TreeMap<KeyType, ValueType>::find(const KeyType &key) const {
+    return findAux(key, m_root);
+}
+
+/* private member functions */
+
+template<typename KeyType, typename ValueType>
+void TreeMap<KeyType, ValueType>::clearAux(TreeMap::Node* &root) {
+
+    if(root == nullptr)
+        return;
+
+    if (root->m_left != nullptr)
+        clearAux(root->m_left);
+
+    if (root->m_right != nullptr)
+        clearAux(root->m_right);
+
+    delete root;
+    root = nullptr;
+}
+
+template<typename KeyType, typename ValueType>
+void TreeMap<KeyType, ValueType>::associateAux(const KeyType &key, const ValueType &value, Node* &root) {
+
+    if (root == nullptr) {
+        root = new Node(key, value, nullptr, nullptr);
+        m_size++;
+        return;
+    }
+
+    if (root->m_key == key) {
+        root->m_val = value;
+        return;
+    }
+
+    if (root->m_key < key)
+        associateAux(key, value, root->m_right);
+    else
+        associateAux(key, value, root->m_left);
+}
+
+template<typename KeyType, typename ValueType>
+ValueType* TreeMap<KeyType, ValueType>::findAux(const KeyType &key, Node *root) const {
+
+    if (root == nullptr)
+        return nullptr;
+
+    if (root->m_key == key)
+        return &(root->m_val);
+
+    if (root->m_key < key)
+        return findAux(key, root->m_right);
+    else
+        return findAux(key, root->m_left);
+}
+
+struct Timing
+{
+    int distinct;
+    double buildMs;
+    double findMs;
+    long long found;                        // keeps the lookups from being optimized away
+};
+
+double msSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+    //associates keys[i] with i in a fresh Map, then finds every key rounds more times
+template<typename Map, typename Key>
+Timing measure(const vector<Key>& keys, int rounds)
+{
+    Timing t;
+    Map map;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (size_t i = 0; i < keys.size(); i++)
+        if (map.find(keys[i]) == nullptr)
+            map.associate(keys[i], static_cast<int>(i));
+    t.buildMs = msSince(start);
+    t.distinct = map.size();
+
+    t.found = 0;
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+        for (size_t i = 0; i < keys.size(); i++) {
+            const int* value = map.find(keys[i]);
+            if (value != nullptr)
+                t.found += *value;
+        }
+    t.findMs = msSince(start);
+    return t;
+}
+
+void report(const string& name, const Timing& tree, const Timing& hash, bool csv, bool last)
+{
+    if (csv) {
+        cout << name << "_distinct," << hash.distinct << endl;
+        cout << name << "_tree_build_ms," << tree.buildMs << endl;
+        cout << name << "_hash_build_ms," << hash.buildMs << endl;
+        cout << name << "_tree_find_ms," << tree.findMs << endl;
+        cout << name << "_hash_find_ms," << hash.findMs << endl;
+        return;
+    }
+
+    cout << "  \"" << name << "\": { \"distinct\": " << hash.distinct
+         << ", \"tree_build_ms\": " << tree.buildMs << ", \"hash_build_ms\": " << hash.buildMs
+         << ", \"tree_find_ms\": " << tree.findMs << ", \"hash_find_ms\": " << hash.findMs << " }"
+         << (last ? "" : ",") << endl;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        cout << "Usage: bench_mymap mapdata.txt [-rounds N] [-csv]" << endl;
+        return 1;
+    }
+
+    int rounds = 10;
+    bool csv = false;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-rounds") == 0  &&  i + 1 < argc  &&  atoi(argv[i+1]) > 0)
+            rounds = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-csv") == 0)
+            csv = true;
+        else {
+            cout << "Usage: bench_mymap mapdata.txt [-rounds N] [-csv]" << endl;
+            return 1;
+        }
+    }
+
+    MapLoader ml;
+    if ( ! ml.load(argv[1])) {
+        cout << "Map data file was not found or has bad format: " << argv[1] << endl;
+        return 1;
+    }
+
+        //the keys in the order the file gives them
+    vector<GeoCoord> coords;
+    vector<string> names;
+    for (size_t i = 0; i < ml.getNumSegments(); i++) {
+        StreetSegment seg;
+        ml.getSegment(i, seg);
+        coords.push_back(seg.segment.start);
+        coords.push_back(seg.segment.end);
+        names.push_back(seg.streetName);
+    }
+
+    Timing coordTree = measure<TreeMap<GeoCoord, int>>(coords, rounds);
+    Timing coordHash = measure<MyMap<GeoCoord, int>>(coords, rounds);
+    Timing nameTree = measure<TreeMap<string, int>>(names, rounds);
+    Timing nameHash = measure<MyMap<string, int>>(names, rounds);
+
+    if (coordTree.found != coordHash.found || nameTree.found != nameHash.found) {
+        cout << "The maps disagree" << endl;
+        return 1;
+    }
+
+    if (csv)
+        cout << "rounds," << rounds << endl;
+    else
+        cout << "{" << endl << "  \"rounds\": " << rounds << "," << endl;
+    report("coords", coordTree, coordHash, csv, false);
+    report("names", nameTree, nameHash, csv, true);
+    if (!csv)
+        cout << "}" << endl;
+    return 0;
+}
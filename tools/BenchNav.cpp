@@ -0,0 +1,473 @@
+// This is the routing benchmark. It loads a map once, routes a seeded random
+// sample of attraction pairs taken from a locations file plus a few fixed
+// long-haul pairs, and prints the results in a machine-readable form so that
+// two runs (before and after an engine change, say) can simply be diffed:
+//  ./bench_nav mapdata.txt validlocs.txt
+// prints JSON with the load time, the p50/p90/p99/max latency of a query on
+// one thread, the queries per second on 1, 2, ... N threads and the peak
+// resident set size. It also routes the sample again between coordinates, each
+// a seeded random distance of up to about 100 meters from the attraction, and
+// reports that latency and the mean time to snap one coordinate to a street.
+// Last it times name completion (Navigator::complete, 10 names) for prefixes
+// of the sampled names, half of them with two neighbouring letters swapped.
+//  ./bench_nav mapdata.txt validlocs.txt [-pairs N] [-seed S] [-threads N] [-bidir|-ch|-alt] [-queue Q] [-prefetch] [-csv]
+// -pairs sets the sample size (default 1000), -seed the random seed (default
+// 1), -threads the largest thread count to measure (default: one per core),
+// -bidir, -ch and -alt the search mode as in BruinNav's batch mode, -queue
+// the open list (binary, 4ary (the default) or radix; see OpenList.h),
+// -prefetch reads a snapshot's road network ahead a tile at a time
+// (Navigator::setTilePrefetch),
+// and -csv prints one "metric,value" line per number instead of JSON.
+// Each line of the locations file is "Attraction Name | Street Name"; only the
+// attraction names are used. Build it from the top-level directory with every
+// .cpp except main.cpp, e.g.
+//  g++ -std=c++17 -O2 -pthread -I. -o bench_nav tools/BenchNav.cpp $(ls *.cpp | grep -v main.cpp)
+
+#include "provided.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <cstring>
+#include <cstdlib>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+    // The longest routes between attractions in validlocs.txt, measured on the LA map.
+    // They are always run in addition to the random sample; a pair whose names are not
+    // in the map being benchmarked is left out.
+const char* const longHaulPairs[][2] = {
+    { "Rossiter Hall", "Los Angeles Fire Department Fire Station 58" },
+    { "Mary Chapel", "Robertson Recreation Center" },
+    { "2 Riviera Country Club service road", "Osteria Drago" },
+    { "Robertson Playground", "Coe Memorial Library" },
+    { "Rviera Country Club tennis courts", "Sunset Lot" },
+    { "Kenter Canyon Elementary School", "Viper Room" },
+};
+
+struct Query {
+    string start;
+    string end;
+};
+
+struct CoordQuery {
+    GeoCoord start;
+    GeoCoord end;
+};
+
+struct LatencySummary {
+    size_t count;
+    double meanMs;
+    double p50Ms;
+    double p90Ms;
+    double p99Ms;
+    double maxMs;
+};
+
+double msSince(Clock::time_point t)
+{
+    return chrono::duration<double, milli>(Clock::now() - t).count();
+}
+
+    //nearest-rank percentile of sorted, which must not be empty
+double percentile(const vector<double>& sorted, double p)
+{
+    size_t rank = static_cast<size_t>(p / 100 * sorted.size() + 0.999999);
+    if (rank < 1)
+        rank = 1;
+    if (rank > sorted.size())
+        rank = sorted.size();
+    return sorted[rank - 1];
+}
+
+LatencySummary summarize(vector<double> latencies)
+{
+    LatencySummary s = { latencies.size(), 0, 0, 0, 0, 0 };
+    if (latencies.empty())
+        return s;
+
+    sort(latencies.begin(), latencies.end());
+    double total = 0;
+    for (size_t i = 0; i < latencies.size(); i++)
+        total += latencies[i];
+    s.meanMs = total / latencies.size();
+    s.p50Ms = percentile(latencies, 50);
+    s.p90Ms = percentile(latencies, 90);
+    s.p99Ms = percentile(latencies, 99);
+    s.maxMs = latencies.back();
+    return s;
+}
+
+    //peak resident set size of this process in kilobytes, or -1 if it is not known
+long peakRssKb()
+{
+#ifndef _WIN32
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+#ifdef __APPLE__
+        return usage.ru_maxrss / 1024;      // bytes on macOS
+#else
+        return usage.ru_maxrss;
+#endif
+#endif
+    return -1;
+}
+
+bool readAttractionNames(string locFile, vector<string>& names)
+{
+    ifstream infile(locFile);
+    if ( ! infile)
+        return false;
+
+    string line;
+    while (getline(infile, line))
+    {
+        if ( ! line.empty()  &&  line.back() == '\r')
+            line.pop_back();
+        size_t bar = line.find(" | ");
+        string name = line.substr(0, bar);
+        if ( ! name.empty())
+            names.push_back(name);
+    }
+    return true;
+}
+
+    //routes every query once on one thread and records how long each took
+void measureLatency(const Navigator& nav, const vector<Query>& queries, vector<double>& latencies, size_t& routesFound)
+{
+    vector<NavSegment> directions;
+    latencies.clear();
+    routesFound = 0;
+    for (size_t i = 0; i < queries.size(); i++)
+    {
+        Clock::time_point started = Clock::now();
+        NavResult result = nav.navigate(queries[i].start, queries[i].end, directions);
+        latencies.push_back(msSince(started));
+        if (result == NAV_SUCCESS)
+            routesFound++;
+    }
+}
+
+    //same for queries between coordinates, also adding up the time spent snapping them
+void measureCoordLatency(const Navigator& nav, const vector<CoordQuery>& queries, vector<double>& latencies,
+                         size_t& routesFound, double& lookupMs)
+{
+    vector<NavSegment> directions;
+    NavStats stats;
+    latencies.clear();
+    routesFound = 0;
+    lookupMs = 0;
+    for (size_t i = 0; i < queries.size(); i++)
+    {
+        Clock::time_point started = Clock::now();
+        NavResult result = nav.navigate(queries[i].start, queries[i].end, directions, stats);
+        latencies.push_back(msSince(started));
+        lookupMs += stats.lookupMs;
+        if (result == NAV_SUCCESS)
+            routesFound++;
+    }
+}
+
+    //position within about 100 meters of gc
+GeoCoord nearby(const GeoCoord& gc, mt19937& rng)
+{
+    uniform_real_distribution<double> offset(-0.001, 0.001);
+    return GeoCoord(to_string(gc.latitude + offset(rng)), to_string(gc.longitude + offset(rng)));
+}
+
+    //texts a user might have typed so far: prefixes of names, every other one with a typo
+vector<string> completionTexts(const vector<Query>& queries, mt19937& rng)
+{
+    vector<string> texts;
+    for (size_t i = 0; i < queries.size(); i++)
+    {
+        const string& name = queries[i].start;
+        size_t length = uniform_int_distribution<size_t>(1, name.size())(rng);
+        string text = name.substr(0, length);
+        if (i % 2 == 1  &&  length >= 4)
+            swap(text[length / 2 - 1], text[length / 2]);
+        texts.push_back(text);
+    }
+    return texts;
+}
+
+    //mean microseconds to complete each text
+double measureCompletion(const Navigator& nav, const vector<string>& texts)
+{
+    if (texts.empty())
+        return 0;
+    
+    Clock::time_point started = Clock::now();
+    for (size_t i = 0; i < texts.size(); i++)
+        nav.complete(texts[i], 10);
+    return msSince(started) * 1000 / texts.size();
+}
+
+    //routes every query once, spread over numThreads threads; returns queries per second
+double measureThroughput(const Navigator& nav, const vector<Query>& queries, int numThreads)
+{
+    atomic<size_t> next(0);
+    auto worker = [&]()
+    {
+        vector<NavSegment> directions;
+        for (size_t i = next++; i < queries.size(); i = next++)
+            nav.navigate(queries[i].start, queries[i].end, directions);
+    };
+
+    Clock::time_point started = Clock::now();
+    vector<thread> workers;
+    for (int t = 1; t < numThreads; t++)
+        workers.push_back(thread(worker));
+    worker();
+    for (size_t t = 0; t < workers.size(); t++)
+        workers[t].join();
+    double seconds = msSince(started) / 1000;
+
+    return seconds > 0 ? queries.size() / seconds : 0;
+}
+
+const char* queueName(QueueKind kind)
+{
+    switch (kind)
+    {
+        case QUEUE_BINARY:          return "binary";
+        case QUEUE_QUATERNARY:      return "4ary";
+        case QUEUE_RADIX:           return "radix";
+    }
+    return "";
+}
+
+const char* modeName(SearchMode mode)
+{
+    switch (mode)
+    {
+        case SEARCH_ASTAR:          return "astar";
+        case SEARCH_BIDIRECTIONAL:  return "bidir";
+        case SEARCH_CONTRACTION:    return "ch";
+        case SEARCH_LANDMARKS:      return "alt";
+    }
+    return "";
+}
+
+    //escapes the characters JSON does not allow inside a string
+string jsonString(const string& s)
+{
+    string out = "\"";
+    for (size_t i = 0; i < s.size(); i++)
+    {
+        if (s[i] == '"'  ||  s[i] == '\\')
+            out += '\\';
+        out += s[i];
+    }
+    return out + "\"";
+}
+
+int main(int argc, char *argv[])
+{
+    int numPairs = 1000;
+    unsigned seed = 1;
+    int maxThreads = thread::hardware_concurrency();
+    SearchMode mode = SEARCH_ASTAR;
+    QueueKind queue = QUEUE_QUATERNARY;
+    bool csv = false;
+    bool prefetch = false;
+    bool ok = (argc >= 3);
+    for (int i = 3; ok  &&  i < argc; i++)
+    {
+        if (strcmp(argv[i], "-pairs") == 0  &&  i + 1 < argc  &&  atoi(argv[i+1]) >= 0)
+            numPairs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-seed") == 0  &&  i + 1 < argc)
+            seed = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        else if (strcmp(argv[i], "-threads") == 0  &&  i + 1 < argc  &&  atoi(argv[i+1]) > 0)
+            maxThreads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-bidir") == 0)
+            mode = SEARCH_BIDIRECTIONAL;
+        else if (strcmp(argv[i], "-ch") == 0)
+            mode = SEARCH_CONTRACTION;
+        else if (strcmp(argv[i], "-alt") == 0)
+            mode = SEARCH_LANDMARKS;
+        else if (strcmp(argv[i], "-queue") == 0  &&  i + 1 < argc)
+        {
+            i++;
+            if (strcmp(argv[i], queueName(QUEUE_BINARY)) == 0)
+                queue = QUEUE_BINARY;
+            else if (strcmp(argv[i], queueName(QUEUE_QUATERNARY)) == 0)
+                queue = QUEUE_QUATERNARY;
+            else if (strcmp(argv[i], queueName(QUEUE_RADIX)) == 0)
+                queue = QUEUE_RADIX;
+            else
+                ok = false;
+        }
+        else if (strcmp(argv[i], "-prefetch") == 0)
+            prefetch = true;
+        else if (strcmp(argv[i], "-csv") == 0)
+            csv = true;
+        else
+            ok = false;
+    }
+    if ( ! ok)
+    {
+        cerr << "Usage: bench_nav mapdata.txt validlocs.txt [-pairs N] [-seed S] [-threads N] [-bidir|-ch|-alt] [-queue binary|4ary|radix] [-prefetch] [-csv]" << endl;
+        return 1;
+    }
+    if (maxThreads < 1)
+        maxThreads = 1;
+
+    string mapFile = argv[1];
+    vector<string> names;
+    if ( ! readAttractionNames(argv[2], names)  ||  names.size() < 2)
+    {
+        cerr << "Locations file was not found or has fewer than two names: " << argv[2] << endl;
+        return 1;
+    }
+
+    Navigator nav;
+    Clock::time_point started = Clock::now();
+    if ( ! nav.loadMapData(mapFile))
+    {
+        cerr << "Map data file was not found or has bad format: " << mapFile << endl;
+        return 1;
+    }
+    double loadMs = msSince(started);
+
+        //the contraction hierarchy and landmarks are prepared here unless the snapshot has them
+    started = Clock::now();
+    nav.setSearchMode(mode);
+    nav.setQueueKind(queue);
+    double prepareMs = msSince(started);
+    nav.setTilePrefetch(prefetch);
+
+    mt19937 rng(seed);
+    uniform_int_distribution<size_t> pick(0, names.size() - 1);
+    vector<Query> sample;
+    for (int i = 0; i < numPairs; i++)
+    {
+        Query q;
+        q.start = names[pick(rng)];
+        do
+            q.end = names[pick(rng)];
+        while (q.end == q.start);
+        sample.push_back(q);
+    }
+
+    vector<Query> longHaul;
+    vector<NavSegment> directions;
+    for (size_t i = 0; i < sizeof(longHaulPairs) / sizeof(longHaulPairs[0]); i++)
+    {
+        Query q = { longHaulPairs[i][0], longHaulPairs[i][1] };
+        NavResult result = nav.navigate(q.start, q.end, directions);
+        if (result != NAV_BAD_SOURCE  &&  result != NAV_BAD_DESTINATION)
+            longHaul.push_back(q);
+    }
+
+    vector<Query> all = sample;
+    all.insert(all.end(), longHaul.begin(), longHaul.end());
+
+        //one untimed pass first, so that every query runs with warm caches and workspaces
+    measureThroughput(nav, all, 1);
+
+    vector<double> latencies;
+    size_t sampleFound, longHaulFound;
+    measureLatency(nav, sample, latencies, sampleFound);
+    LatencySummary sampleLatency = summarize(latencies);
+    measureLatency(nav, longHaul, latencies, longHaulFound);
+    LatencySummary longHaulLatency = summarize(latencies);
+
+    vector<double> qps;
+    for (int t = 1; t <= maxThreads; t++)
+        qps.push_back(measureThroughput(nav, all, t));
+
+    long rss = peakRssKb();
+
+        //the sample's routes start and end at the attractions' coordinates
+    vector<CoordQuery> coords;
+    for (size_t i = 0; i < sample.size(); i++)
+    {
+        if (nav.navigate(sample[i].start, sample[i].end, directions) != NAV_SUCCESS  ||  directions.empty())
+            continue;
+        CoordQuery q = { nearby(directions.front().m_geoSegment.start, rng),
+                         nearby(directions.back().m_geoSegment.end, rng) };
+        coords.push_back(q);
+    }
+    size_t coordsFound;
+    double lookupMs;
+    measureCoordLatency(nav, coords, latencies, coordsFound, lookupMs);
+    measureCoordLatency(nav, coords, latencies, coordsFound, lookupMs);   //the first pass warms up
+    LatencySummary coordLatency = summarize(latencies);
+    double snapUs = coords.empty() ? 0 : lookupMs * 1000 / (2 * coords.size());
+    
+    vector<string> texts = completionTexts(sample, rng);
+    measureCompletion(nav, texts);                                         //warm up
+    double completeUs = measureCompletion(nav, texts);
+
+    const LatencySummary* sets[3] = { &sampleLatency, &longHaulLatency, &coordLatency };
+    const char* setNames[3] = { "sample", "longhaul", "coords" };
+    size_t found[3] = { sampleFound, longHaulFound, coordsFound };
+
+    cout.setf(ios::fixed);
+    cout.precision(4);
+    if (csv)
+    {
+        cout << "metric,value" << endl;
+        cout << "mode," << modeName(mode) << endl;
+        cout << "queue," << queueName(queue) << endl;
+        cout << "prefetch," << (prefetch ? 1 : 0) << endl;
+        cout << "seed," << seed << endl;
+        cout << "load_ms," << loadMs << endl;
+        cout << "prepare_ms," << prepareMs << endl;
+        for (int s = 0; s < 3; s++)
+        {
+            cout << setNames[s] << "_queries," << sets[s]->count << endl;
+            cout << setNames[s] << "_routes_found," << found[s] << endl;
+            cout << setNames[s] << "_mean_ms," << sets[s]->meanMs << endl;
+            cout << setNames[s] << "_p50_ms," << sets[s]->p50Ms << endl;
+            cout << setNames[s] << "_p90_ms," << sets[s]->p90Ms << endl;
+            cout << setNames[s] << "_p99_ms," << sets[s]->p99Ms << endl;
+            cout << setNames[s] << "_max_ms," << sets[s]->maxMs << endl;
+        }
+        cout << "snap_mean_us," << snapUs << endl;
+        cout << "complete_mean_us," << completeUs << endl;
+        for (size_t t = 0; t < qps.size(); t++)
+            cout << "qps_threads_" << t + 1 << "," << qps[t] << endl;
+        cout << "peak_rss_kb," << rss << endl;
+    }
+    else
+    {
+        cout << "{" << endl;
+        cout << "  \"map\": " << jsonString(mapFile) << "," << endl;
+        cout << "  \"mode\": \"" << modeName(mode) << "\"," << endl;
+        cout << "  \"queue\": \"" << queueName(queue) << "\"," << endl;
+        cout << "  \"prefetch\": " << (prefetch ? "true" : "false") << "," << endl;
+        cout << "  \"seed\": " << seed << "," << endl;
+        cout << "  \"load_ms\": " << loadMs << "," << endl;
+        cout << "  \"prepare_ms\": " << prepareMs << "," << endl;
+        for (int s = 0; s < 3; s++)
+        {
+            cout << "  \"" << setNames[s] << "\": { \"queries\": " << sets[s]->count
+                 << ", \"routes_found\": " << found[s]
+                 << ", \"mean_ms\": " << sets[s]->meanMs
+                 << ", \"p50_ms\": " << sets[s]->p50Ms
+                 << ", \"p90_ms\": " << sets[s]->p90Ms
+                 << ", \"p99_ms\": " << sets[s]->p99Ms
+                 << ", \"max_ms\": " << sets[s]->maxMs << " }," << endl;
+        }
+        cout << "  \"snap_mean_us\": " << snapUs << "," << endl;
+        cout << "  \"complete_mean_us\": " << completeUs << "," << endl;
+        cout << "  \"qps\": [";
+        for (size_t t = 0; t < qps.size(); t++)
+            cout << (t == 0 ? "" : ", ") << "{ \"threads\": " << t + 1 << ", \"qps\": " << qps[t] << " }";
+        cout << "]," << endl;
+        cout << "  \"peak_rss_kb\": " << rss << endl;
+        cout << "}" << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+// This is the text map parsing benchmark. It times MapLoader::load on a text
+// map, read and parsed in one piece and in record-aligned chunks:
+//  ./bench_parse big.txt [-rounds N] [-chunks N] [-csv]
+// loads the map N times each way (default 5) and prints JSON with the file's
+// size, its segments, and for each way the best time and the throughput in
+// MB/s that it gives. -chunks sets the chunks of the chunked loads (default:
+// one per core, which on a one-core machine is one piece again); -csv prints
+// one "metric,value" line per number instead. A large map to time can be made
+// with tools/MapGen.cpp; the map must not have an up-to-date snapshot beside
+// it, which load would read instead. Build it from the top-level directory
+// with every .cpp except main.cpp, e.g.
+//  g++ -std=c++17 -O2 -pthread -I. -o bench_parse tools/BenchParse.cpp $(ls *.cpp | grep -v main.cpp)
+
+#include "provided.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+using namespace std;
+
+namespace {
+
+struct Timing
+{
+    double bestMs;
+    int chunks;                             // as getParseChunks reported
+    size_t segments;
+};
+
+    //best of rounds loads with the given setParseChunks; false if a load fails
+bool timeLoads(const string& file, int chunks, int rounds, Timing& t)
+{
+    t.bestMs = -1;
+    for (int r = 0; r < rounds; r++)
+    {
+        MapLoader ml;
+        ml.setParseChunks(chunks);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        if ( ! ml.load(file)  ||  ml.getSnapshot() != nullptr)
+            return false;
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if (t.bestMs < 0  ||  ms < t.bestMs)
+            t.bestMs = ms;
+        t.chunks = ml.getParseChunks();
+        t.segments = ml.getNumSegments();
+    }
+    return true;
+}
+
+double mbPerSecond(size_t bytes, double ms)
+{
+    return ms > 0 ? bytes / 1e6 / (ms / 1000) : 0;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        cout << "Usage: bench_parse map.txt [-rounds N] [-chunks N] [-csv]" << endl;
+        return 1;
+    }
+
+    int rounds = 5;
+    int chunks = 0;
+    bool csv = false;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-rounds") == 0  &&  i + 1 < argc  &&  atoi(argv[i+1]) > 0)
+            rounds = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-chunks") == 0  &&  i + 1 < argc  &&  atoi(argv[i+1]) > 0)
+            chunks = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-csv") == 0)
+            csv = true;
+        else {
+            cout << "Usage: bench_parse map.txt [-rounds N] [-chunks N] [-csv]" << endl;
+            return 1;
+        }
+    }
+
+    ifstream in(argv[1], ios::binary | ios::ate);
+    if ( ! in) {
+        cout << "Map data file was not found: " << argv[1] << endl;
+        return 1;
+    }
+    size_t bytes = static_cast<size_t>(in.tellg());
+
+    Timing whole, chunked;
+    if ( ! timeLoads(argv[1], 1, rounds, whole)  ||  ! timeLoads(argv[1], chunks, rounds, chunked)) {
+        cout << "Map data file has bad format, or was loaded from a snapshot: " << argv[1] << endl;
+        return 1;
+    }
+
+    if (csv) {
+        cout << "bytes," << bytes << endl << "segments," << whole.segments << endl << "rounds," << rounds << endl;
+        cout << "whole_ms," << whole.bestMs << endl << "whole_mb_s," << mbPerSecond(bytes, whole.bestMs) << endl;
+        cout << "chunks," << chunked.chunks << endl;
+        cout << "chunked_ms," << chunked.bestMs << endl << "chunked_mb_s," << mbPerSecond(bytes, chunked.bestMs) << endl;
+        return 0;
+    }
+
+    cout << "{" << endl
+         << "  \"bytes\": " << bytes << ", \"segments\": " << whole.segments << ", \"rounds\": " << rounds << "," << endl
+         << "  \"whole\": { \"ms\": " << whole.bestMs << ", \"mb_s\": " << mbPerSecond(bytes, whole.bestMs) << " }," << endl
+         << "  \"chunked\": { \"chunks\": " << chunked.chunks << ", \"ms\": " << chunked.bestMs
+         << ", \"mb_s\": " << mbPerSecond(bytes, chunked.bestMs) << " }" << endl
+         << "}" << endl;
+    return 0;
+}
@@ -0,0 +1,243 @@
+// This is the concurrency check. It verifies that Navigator::navigate gives
+// the same answers when called from many threads at once as it does serially:
+//  ./ConcurrencyCheck mapdata.txt validlocs.txt [-pairs N] [-threads N] [-rounds N] [-seed S]
+// routes a seeded random sample of attraction pairs taken from the locations
+// file (default 300), and as many pairs of coordinates near them, once on one
+// thread in each search mode, and then routes every one of them rounds times
+// (default 3) on threads threads (default 8) at once, each thread starting
+// at a different place in the sample, once with the route cache off and once
+// with it holding a quarter of the sample, so that threads share, insert and
+// evict cached routes. Every concurrent answer must equal the serial one: the
+// same NavResult and, for a route, the same directions, field by field. It
+// prints one line per mode and exits with status 1 if any answer differs.
+// Building it with -fsanitize=thread as well checks for data races. Each line
+// of the locations file is "Attraction Name | Street Name". Build it from the
+// top-level directory with every .cpp except main.cpp, e.g.
+//  g++ -std=c++17 -O2 -pthread -I. -o ConcurrencyCheck tools/ConcurrencyCheck.cpp $(ls *.cpp | grep -v main.cpp)
+
+#include "provided.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <cstring>
+#include <cstdlib>
+using namespace std;
+
+namespace {
+
+struct Query {
+    bool byName;
+    string start;
+    string end;
+    GeoCoord startCoord;
+    GeoCoord endCoord;
+};
+
+struct Answer {
+    NavResult result;
+    vector<NavSegment> directions;
+};
+
+bool readAttractionNames(string locFile, vector<string>& names)
+{
+    ifstream infile(locFile);
+    if ( ! infile)
+        return false;
+
+    string line;
+    while (getline(infile, line))
+    {
+        if ( ! line.empty()  &&  line.back() == '\r')
+            line.pop_back();
+        string name = line.substr(0, line.find(" | "));
+        if ( ! name.empty())
+            names.push_back(name);
+    }
+    return true;
+}
+
+bool sameCoord(const GeoCoord& a, const GeoCoord& b)
+{
+    return a.latitude == b.latitude  &&  a.longitude == b.longitude  &&
+           a.latitudeText == b.latitudeText  &&  a.longitudeText == b.longitudeText;
+}
+
+bool sameAnswer(const Answer& a, NavResult result, const vector<NavSegment>& directions)
+{
+    if (a.result != result)
+        return false;
+    if (result != NAV_SUCCESS)
+        return true;                        // navigate leaves the directions as they were
+    if (a.directions.size() != directions.size())
+        return false;
+    for (size_t i = 0; i < directions.size(); i++)
+    {
+        const NavSegment& x = a.directions[i];
+        const NavSegment& y = directions[i];
+        if (x.m_command != y.m_command  ||  x.m_direction != y.m_direction  ||  x.m_streetName != y.m_streetName)
+            return false;
+            //a turn's distance and segment are not set
+        if (x.m_command == NavSegment::PROCEED  &&
+            (x.m_distance != y.m_distance  ||  ! sameCoord(x.m_geoSegment.start, y.m_geoSegment.start)  ||
+             ! sameCoord(x.m_geoSegment.end, y.m_geoSegment.end)))
+            return false;
+    }
+    return true;
+}
+
+NavResult route(const Navigator& nav, const Query& q, vector<NavSegment>& directions)
+{
+    if (q.byName)
+        return nav.navigate(q.start, q.end, directions);
+    return nav.navigate(q.startCoord, q.endCoord, directions);
+}
+
+    //routes every query rounds times on numThreads threads at once; returns the answers that differ from expected
+size_t checkConcurrently(const Navigator& nav, const vector<Query>& queries, const vector<Answer>& expected,
+                         int numThreads, int rounds)
+{
+    atomic<size_t> mismatches(0);
+    auto worker = [&](int t)
+    {
+        vector<NavSegment> directions;
+        size_t first = queries.size() * t / numThreads;
+        for (size_t n = 0; n < queries.size() * rounds; n++)
+        {
+            size_t i = (first + n) % queries.size();
+            NavResult result = route(nav, queries[i], directions);
+            if ( ! sameAnswer(expected[i], result, directions))
+                mismatches++;
+        }
+    };
+
+    vector<thread> workers;
+    for (int t = 0; t < numThreads; t++)
+        workers.push_back(thread(worker, t));
+    for (size_t t = 0; t < workers.size(); t++)
+        workers[t].join();
+    return mismatches;
+}
+
+const char* modeName(SearchMode mode)
+{
+    switch (mode)
+    {
+        case SEARCH_ASTAR:          return "astar";
+        case SEARCH_BIDIRECTIONAL:  return "bidir";
+        case SEARCH_CONTRACTION:    return "ch";
+        case SEARCH_LANDMARKS:      return "alt";
+    }
+    return "";
+}
+}
+
+int main(int argc, char *argv[])
+{
+    const char* usage = "Usage: ConcurrencyCheck mapdata.txt validlocs.txt [-pairs N] [-threads N] [-rounds N] [-seed S]";
+    if (argc < 3)
+    {
+        cout << usage << endl;
+        return 1;
+    }
+
+    size_t numPairs = 300;
+    int numThreads = 8;
+    int rounds = 3;
+    unsigned seed = 1;
+    for (int i = 3; i < argc; i++)
+    {
+        int value = (i + 1 < argc ? atoi(argv[i+1]) : 0);
+        if (value <= 0)
+        {
+            cout << usage << endl;
+            return 1;
+        }
+        if (strcmp(argv[i], "-pairs") == 0)
+            numPairs = value;
+        else if (strcmp(argv[i], "-threads") == 0)
+            numThreads = value;
+        else if (strcmp(argv[i], "-rounds") == 0)
+            rounds = value;
+        else if (strcmp(argv[i], "-seed") == 0)
+            seed = value;
+        else
+        {
+            cout << usage << endl;
+            return 1;
+        }
+        i++;
+    }
+
+    Navigator nav;
+    if ( ! nav.loadMapData(argv[1]))
+    {
+        cout << "Map data file was not found or has bad format: " << argv[1] << endl;
+        return 1;
+    }
+    vector<string> names;
+    if ( ! readAttractionNames(argv[2], names)  ||  names.empty())
+    {
+        cout << "Locations file was not found or is empty: " << argv[2] << endl;
+        return 1;
+    }
+
+        //the coordinate queries are made from the ends of the directions of the name queries
+    mt19937 rng(seed);
+    uniform_int_distribution<size_t> pick(0, names.size() - 1);
+    uniform_real_distribution<double> offset(-0.001, 0.001);
+    vector<Query> queries;
+    vector<NavSegment> directions;
+    for (size_t i = 0; i < numPairs; i++)
+    {
+        Query q;
+        q.byName = true;
+        q.start = names[pick(rng)];
+        q.end = names[pick(rng)];
+        queries.push_back(q);
+        if (nav.navigate(q.start, q.end, directions) == NAV_SUCCESS  &&  ! directions.empty())
+        {
+            const GeoCoord& a = directions.front().m_geoSegment.start;
+            const GeoCoord& b = directions.back().m_geoSegment.end;
+            q.byName = false;
+            q.startCoord = GeoCoord(to_string(a.latitude + offset(rng)), to_string(a.longitude + offset(rng)));
+            q.endCoord = GeoCoord(to_string(b.latitude + offset(rng)), to_string(b.longitude + offset(rng)));
+            queries.push_back(q);
+        }
+    }
+
+    const SearchMode modes[] = { SEARCH_ASTAR, SEARCH_BIDIRECTIONAL, SEARCH_CONTRACTION, SEARCH_LANDMARKS };
+    size_t failures = 0;
+    for (SearchMode mode : modes)
+    {
+        nav.setSearchMode(mode);
+        nav.setRouteCacheCapacity(0);
+        vector<Answer> expected(queries.size());
+        size_t routes = 0;
+        for (size_t i = 0; i < queries.size(); i++)
+        {
+            expected[i].result = route(nav, queries[i], expected[i].directions);
+            if (expected[i].result == NAV_SUCCESS)
+                routes++;
+        }
+
+        size_t uncached = checkConcurrently(nav, queries, expected, numThreads, rounds);
+        nav.setRouteCacheCapacity(queries.size() / 4 + 1);
+        RouteCacheStats before = nav.getRouteCacheStats();
+        size_t cached = checkConcurrently(nav, queries, expected, numThreads, rounds);
+        RouteCacheStats cs = nav.getRouteCacheStats();
+        cs.hits -= before.hits;
+        cs.evictions -= before.evictions;
+
+        cout << modeName(mode) << ": " << queries.size() << " queries (" << routes << " routes) x " << rounds
+             << " rounds on " << numThreads << " threads: " << uncached << " differ uncached, " << cached
+             << " differ cached (" << cs.hits << " hits, " << cs.evictions << " evictions)" << endl;
+        failures += uncached + cached;
+    }
+
+    cout << (failures == 0 ? "All concurrent answers match the serial ones" : to_string(failures) + " concurrent answers differ") << endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+// This is the heuristic check. It verifies that the A* heuristic
+// (DistanceBound in support.h) never overestimates for a map:
+//  ./HeuristicCheck mapdata.txt
+// fits the bound to the map's bounding box exactly as Navigator does and
+// compares it with distanceEarthMiles
+//  - between every pair of points on a 101 x 101 grid spanning the box
+//    (corners and edges included), and
+//  - between the two ends of every edge of the road graph, which is what
+//    makes the heuristic consistent as well as admissible.
+// It prints the largest ratio of bound to true distance seen (which must
+// not exceed 1) and exits with status 1 if any check fails. Build it from
+// the top-level directory with every .cpp except main.cpp, e.g.
+//  g++ -std=c++17 -O2 -I. -o HeuristicCheck tools/HeuristicCheck.cpp $(ls *.cpp | grep -v main.cpp)
+
+#include "provided.h"
+#include "support.h"
+#include "RoadGraph.h"
+#include <iostream>
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2)
+    {
+        cout << "Usage: HeuristicCheck mapdata.txt" << endl;
+        return 1;
+    }
+
+    MapLoader ml;
+    if ( ! ml.load(argv[1]))
+    {
+        cout << "Map data file was not found or has bad format: " << argv[1] << endl;
+        return 1;
+    }
+
+    RoadGraph graph;
+    graph.build(ml);
+    FixedCoord lo, hi;
+    graph.bounds(lo, hi);
+    DistanceBound bound;
+    bound.init(lo, hi);
+
+    cout.precision(12);
+    cout << "Box: " << lo.latitude() << "," << lo.longitude() << " to " << hi.latitude() << "," << hi.longitude() << endl;
+
+    const int steps = 100;
+    vector<FixedCoord> grid;
+    for (int i = 0; i <= steps; i++)
+    {
+        for (int j = 0; j <= steps; j++)
+        {
+            FixedCoord fc;
+            fc.lat = static_cast<int32_t>(lo.lat + (static_cast<int64_t>(hi.lat) - lo.lat) * i / steps);
+            fc.lon = static_cast<int32_t>(lo.lon + (static_cast<int64_t>(hi.lon) - lo.lon) * j / steps);
+            grid.push_back(fc);
+        }
+    }
+
+    double worstGrid = 0;
+    size_t gridFailures = 0;
+    for (size_t a = 0; a < grid.size(); a++)
+    {
+        for (size_t b = a + 1; b < grid.size(); b++)
+        {
+            double truth = distanceEarthMiles(grid[a], grid[b]);
+            double h = bound.miles(grid[a], grid[b]);
+            if (h > truth)
+                gridFailures++;
+            if (truth > 0)
+                worstGrid = max(worstGrid, h / truth);
+        }
+    }
+
+    double worstEdge = 0;
+    double loosestEdge = 1;
+    size_t edgeFailures = 0;
+    for (int v = 0; v < graph.numNodes(); v++)
+    {
+        for (int e = graph.edgeBegin(v); e < graph.edgeEnd(v); e++)
+        {
+            double h = bound.miles(graph.coord(v), graph.coord(graph.target(e)));
+            if (h > graph.weight(e))
+                edgeFailures++;
+            if (graph.weight(e) > 0)
+            {
+                worstEdge = max(worstEdge, h / graph.weight(e));
+                loosestEdge = min(loosestEdge, h / graph.weight(e));
+            }
+        }
+    }
+
+    size_t gridPairs = grid.size() * (grid.size() - 1) / 2;
+    cout << "Grid: " << gridPairs << " pairs, " << gridFailures << " overestimates, largest ratio " << worstGrid << endl;
+    cout << "Edges: " << graph.numEdges() << " edges, " << edgeFailures << " overestimates, ratio from "
+         << loosestEdge << " to " << worstEdge << endl;
+
+    return (gridFailures == 0  &&  edgeFailures == 0) ? 0 : 1;
+}
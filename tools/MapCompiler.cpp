@@ -0,0 +1,36 @@
+// This is the MapCompiler routine. It parses a text map once and writes a
+// precompiled snapshot that BruinNav can map straight into memory:
+//  ./MapCompiler mapdata.txt
+// writes mapdata.txt.snap, which Navigator::loadMapData("mapdata.txt") then
+// picks up automatically for as long as mapdata.txt is unchanged, or
+//  ./MapCompiler mapdata.txt la.snap
+// writes la.snap, which can be passed to BruinNav in place of the text file.
+// Build it from the top-level directory with every .cpp except main.cpp, e.g.
+//  g++ -std=c++17 -O2 -I. -o MapCompiler tools/MapCompiler.cpp $(ls *.cpp | grep -v main.cpp)
+
+#include "provided.h"
+#include "MapSnapshot.h"
+#include <iostream>
+#include <string>
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2  &&  argc != 3)
+    {
+        cout << "Usage: MapCompiler mapdata.txt [snapshot file]" << endl;
+        return 1;
+    }
+    
+    string mapFile = argv[1];
+    string snapFile = (argc == 3 ? argv[2] : mapFile + ".snap");
+    
+    if ( ! compileMapSnapshot(mapFile, snapFile))
+    {
+        cout << "Could not compile " << mapFile << " into " << snapFile << endl;
+        return 1;
+    }
+    
+    cout << "Wrote " << snapFile << endl;
+    return 0;
+}
@@ -0,0 +1,104 @@
+// This is the map generator. It writes a large text map, for the load and
+// routing benchmarks, by laying copies of a map side by side:
+//  ./MapGen mapdata.txt 50 big.txt
+// writes 50 copies of mapdata.txt to big.txt, each moved east of the last by
+// the width of the map's bounding box plus a hundredth of a degree, so that
+// the copies are separate cities that no street joins. The first copy keeps
+// its attraction names; copy k after it appends " k" to them, so that every
+// name is still unique. Coordinates are written with seven decimals, like
+// mapdata.txt. Build it from the top-level directory with every .cpp except
+// main.cpp, e.g.
+//  g++ -std=c++17 -O2 -pthread -I. -o MapGen tools/MapGen.cpp $(ls *.cpp | grep -v main.cpp)
+
+#include "provided.h"
+#include "support.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+using namespace std;
+
+namespace {
+
+string coordText(const FixedCoord& fc, int32_t shift, const char* separator)
+{
+    return fixedToText(fc.lat) + separator + fixedToText(fc.lon + shift);
+}
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 4  ||  atoi(argv[2]) <= 0)
+    {
+        cout << "Usage: MapGen mapdata.txt copies out.txt" << endl;
+        return 1;
+    }
+
+    MapLoader ml;
+    if ( ! ml.load(argv[1]))
+    {
+        cout << "Map data file was not found or has bad format: " << argv[1] << endl;
+        return 1;
+    }
+    const MapTables& tables = ml.getTables();
+    if (tables.segments.empty())
+    {
+        cout << "The map has no segments: " << argv[1] << endl;
+        return 1;
+    }
+
+    int32_t west = tables.segments[0].start.lon, east = west;
+    for (size_t i = 0; i < tables.segments.size(); i++)
+    {
+        const SegmentRecord& seg = tables.segments[i];
+        west = min(west, min(seg.start.lon, seg.end.lon));
+        east = max(east, max(seg.start.lon, seg.end.lon));
+    }
+    for (size_t i = 0; i < tables.attractions.size(); i++)
+    {
+        west = min(west, tables.attractions[i].coord.lon);
+        east = max(east, tables.attractions[i].coord.lon);
+    }
+
+    int copies = atoi(argv[2]);
+    int64_t step = static_cast<int64_t>(east) - west + 100000;      // the box's width and 0.01 degrees
+    if (static_cast<int64_t>(east) + step * (copies - 1) > 1800000000LL)
+    {
+        cout << "That many copies would run past 180 degrees east" << endl;
+        return 1;
+    }
+
+    ofstream out(argv[3], ios::binary);
+    if ( ! out)
+    {
+        cout << "Cannot write " << argv[3] << endl;
+        return 1;
+    }
+
+    for (int k = 0; k < copies; k++)
+    {
+        int32_t shift = static_cast<int32_t>(step * k);
+        string suffix = (k == 0 ? "" : " " + to_string(k));
+        for (size_t i = 0; i < tables.segments.size(); i++)
+        {
+            const SegmentRecord& seg = tables.segments[i];
+            out << tables.names.get(seg.name) << '\n'
+                << coordText(seg.start, shift, ", ") << ' ' << coordText(seg.end, shift, ",") << '\n'
+                << seg.numAttractions << '\n';
+            for (int j = 0; j < seg.numAttractions; j++)
+            {
+                const AttractionRecord& att = tables.attractions[seg.firstAttraction + j];
+                out << tables.names.get(att.name) << suffix << '|' << coordText(att.coord, shift, ", ") << '\n';
+            }
+        }
+    }
+
+    if ( ! out.flush())
+    {
+        cout << "Cannot write " << argv[3] << endl;
+        return 1;
+    }
+    cout << "Wrote " << copies << " copies of " << tables.segments.size() << " segments to " << argv[3] << endl;
+    return 0;
+}
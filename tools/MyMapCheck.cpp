@@ -0,0 +1,126 @@
+// This is the MyMap check. It verifies MyMap against std::unordered_map
+// under a long seeded random mix of operations:
+//  ./MyMapCheck [-ops N] [-seed S]
+// associates (new keys and existing ones), removes (present and absent keys)
+// and finds, N times (default 1000000), on keys drawn from a small range so
+// that the map keeps growing and shrinking around its resize points, and
+// clears it now and then. It does this three times: with the default hash,
+// with a hash that sends runs of 64 keys to one value, so that every probe
+// walks a long cluster and removal has to shift entries back across it, and
+// with string keys. After every operation the result must match
+// unordered_map's, and every so often every key in the range is looked up
+// in both. It prints one line per run and exits with status 1 if any check
+// fails. Build it from the top-level directory, e.g.
+//  g++ -std=c++17 -O2 -I. -o MyMapCheck tools/MyMapCheck.cpp
+
+#include "MyMap.h"
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <random>
+#include <cstring>
+#include <cstdlib>
+using namespace std;
+
+namespace {
+
+    //puts runs of 64 consecutive keys on one hash
+struct ClusteringHash
+{
+    size_t operator()(int key) const { return static_cast<size_t>(key / 64); }
+};
+
+int keyOf(int n, int)
+{
+    return n;
+}
+
+string keyOf(int n, const string&)
+{
+    return "key " + to_string(n);
+}
+
+    //runs ops random operations on keys 0..range-1; returns the number of mismatches
+template<typename KeyType, typename Hash>
+size_t check(size_t ops, int range, unsigned seed, const KeyType& sample)
+{
+    MyMap<KeyType, int, Hash> map;
+    unordered_map<KeyType, int> model;
+    mt19937 rng(seed);
+    uniform_int_distribution<int> pickKey(0, range - 1);
+    uniform_int_distribution<int> pickOp(0, 999);
+    size_t mismatches = 0;
+
+    for (size_t i = 0; i < ops; i++)
+    {
+        KeyType key = keyOf(pickKey(rng), sample);
+        int op = pickOp(rng);
+        if (op < 450)
+        {
+            int value = static_cast<int>(i);
+            map.associate(key, value);
+            model[key] = value;
+        }
+        else if (op < 800)
+        {
+            if (map.remove(key) != (model.erase(key) == 1))
+                mismatches++;
+        }
+        else if (op < 999)
+        {
+            const int* found = map.find(key);
+            auto it = model.find(key);
+            if ((found == nullptr) != (it == model.end())  ||  (found != nullptr  &&  *found != it->second))
+                mismatches++;
+        }
+        else
+        {
+            map.clear();
+            model.clear();
+        }
+
+        if (map.size() != static_cast<int>(model.size()))
+            mismatches++;
+
+        if (i % 10007 == 0)
+        {
+            for (int n = 0; n < range; n++)
+            {
+                KeyType k = keyOf(n, sample);
+                const int* found = map.find(k);
+                auto it = model.find(k);
+                if ((found == nullptr) != (it == model.end())  ||  (found != nullptr  &&  *found != it->second))
+                    mismatches++;
+            }
+        }
+    }
+    return mismatches;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    size_t ops = 1000000;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-ops") == 0  &&  i + 1 < argc  &&  atoi(argv[i+1]) > 0)
+            ops = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-seed") == 0  &&  i + 1 < argc  &&  atoi(argv[i+1]) > 0)
+            seed = atoi(argv[++i]);
+        else
+        {
+            cout << "Usage: MyMapCheck [-ops N] [-seed S]" << endl;
+            return 1;
+        }
+    }
+
+    size_t plain = check<int, hash<int>>(ops, 5000, seed, 0);
+    cout << "int keys, std::hash: " << ops << " operations, " << plain << " mismatches" << endl;
+    size_t clustered = check<int, ClusteringHash>(ops, 5000, seed + 1, 0);
+    cout << "int keys, 64 keys per hash: " << ops << " operations, " << clustered << " mismatches" << endl;
+    size_t strings = check<string, hash<string>>(ops, 5000, seed + 2, string());
+    cout << "string keys, std::hash: " << ops << " operations, " << strings << " mismatches" << endl;
+
+    return (plain == 0  &&  clustered == 0  &&  strings == 0) ? 0 : 1;
+}
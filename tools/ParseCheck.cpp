@@ -0,0 +1,106 @@
+// This is the parse check. It verifies that parsing a text map in record-
+// aligned chunks gives exactly the tables that parsing it in one piece does:
+//  ./ParseCheck mapdata.txt [maxChunks]
+// loads the map in one piece (the path MapLoader falls back on) and then in
+// every number of chunks from 2 to maxChunks (default 64), however small that
+// makes them, and compares the segments, attractions, names and number texts
+// of each load with the first, record by record. A chunked load that fell
+// back to one piece counts as a failure too, since its boundaries were never
+// tried. It prints one line per load and exits with status 1 if any check
+// fails. The map must not have an up-to-date snapshot beside it. Build it
+// from the top-level directory with every .cpp except main.cpp, e.g.
+//  g++ -std=c++17 -O2 -pthread -I. -o ParseCheck tools/ParseCheck.cpp $(ls *.cpp | grep -v main.cpp)
+
+#include "provided.h"
+#include "support.h"
+#include <iostream>
+#include <string>
+#include <cstdlib>
+using namespace std;
+
+namespace {
+
+bool sameNames(const NameTable& a, const NameTable& b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (int i = 0; i < a.size(); i++)
+        if (a.length(i) != b.length(i)  ||  a.get(i) != b.get(i))
+            return false;
+    return true;
+}
+
+    //describes the first difference between the two tables, or returns "" if there is none
+string difference(const MapTables& a, const MapTables& b)
+{
+    if (a.segments.size() != b.segments.size())
+        return "segment count " + to_string(a.segments.size()) + " vs " + to_string(b.segments.size());
+    for (size_t i = 0; i < a.segments.size(); i++)
+    {
+        const SegmentRecord& x = a.segments[i];
+        const SegmentRecord& y = b.segments[i];
+        if (x.name != y.name  ||  x.start != y.start  ||  x.end != y.end  ||
+            x.firstAttraction != y.firstAttraction  ||  x.numAttractions != y.numAttractions)
+            return "segment " + to_string(i);
+    }
+
+    if (a.attractions.size() != b.attractions.size())
+        return "attraction count " + to_string(a.attractions.size()) + " vs " + to_string(b.attractions.size());
+    for (size_t i = 0; i < a.attractions.size(); i++)
+        if (a.attractions[i].name != b.attractions[i].name  ||  a.attractions[i].coord != b.attractions[i].coord)
+            return "attraction " + to_string(i);
+
+    if ( ! sameNames(a.names, b.names))
+        return "name table";
+
+    const NumberTexts& ta = a.numberTexts;
+    const NumberTexts& tb = b.numberTexts;
+    if (ta.m_values.size() != tb.m_values.size()  ||  ! sameNames(ta.m_texts, tb.m_texts))
+        return "number texts";
+    for (size_t i = 0; i < ta.m_values.size(); i++)
+        if (ta.m_values[i] != tb.m_values[i])
+            return "number texts";
+
+    return "";
+}
+}
+
+int main(int argc, char *argv[])
+{
+    if ((argc != 2  &&  argc != 3)  ||  (argc == 3  &&  atoi(argv[2]) < 2))
+    {
+        cout << "Usage: ParseCheck mapdata.txt [maxChunks]" << endl;
+        return 1;
+    }
+    int maxChunks = (argc == 3 ? atoi(argv[2]) : 64);
+
+    MapLoader whole;
+    whole.setParseChunks(1);
+    if ( ! whole.load(argv[1])  ||  whole.getSnapshot() != nullptr)
+    {
+        cout << "Map data file was not found, has bad format, or was loaded from a snapshot: " << argv[1] << endl;
+        return 1;
+    }
+    cout << "1 chunk: " << whole.getNumSegments() << " segments" << endl;
+
+    int failures = 0;
+    for (int chunks = 2; chunks <= maxChunks; chunks++)
+    {
+        MapLoader ml;
+        ml.setParseChunks(chunks);
+        string diff;
+        if ( ! ml.load(argv[1]))
+            diff = "load failed";
+        else if (ml.getParseChunks() == 1)
+            diff = "fell back to one piece";
+        else
+            diff = difference(whole.getTables(), ml.getTables());
+
+        cout << chunks << " chunks (" << ml.getParseChunks() << " parsed): " << (diff.empty() ? "same" : "differs, " + diff) << endl;
+        if ( ! diff.empty())
+            failures++;
+    }
+
+    cout << (failures == 0 ? "All chunked parses match" : to_string(failures) + " chunked parses differ") << endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,159 @@
+// This is the route cache check. It verifies that RouteCache keeps the
+// routes a least-recently-used cache of its capacity should:
+//  ./RouteCacheCheck [-ops N] [-seed S]
+// runs a seeded random mix of lookups, inserts (of new routes and of routes
+// already cached), capacity changes (shrinking, growing and turning the cache
+// off) and clears, N times (default 1000000), against a plain list kept in
+// recency order. Every lookup must hit exactly when the list holds the route,
+// and then hand back the directions last inserted for it; after every
+// operation the hits, misses, evictions, size and capacity must equal the
+// model's. Since a wrongly chosen victim shows up as a hit or a miss that
+// the model does not expect, this checks the eviction order as well as the
+// capacity. It prints a summary and exits with status 1 if any check fails.
+// Build it from the top-level directory, e.g.
+//  g++ -std=c++17 -O2 -pthread -I. -o RouteCacheCheck tools/RouteCacheCheck.cpp RouteCache.cpp
+
+#include "RouteCache.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <list>
+#include <random>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+using namespace std;
+
+namespace {
+
+    //RouteCache as a list, most recently used first
+struct Model {
+    struct Route {
+        int source;
+        int target;
+        string tag;
+    };
+    list<Route> routes;
+    size_t capacity = 0;
+    RouteCacheStats stats = { 0, 0, 0, 0, 0 };
+
+    list<Route>::iterator find(int source, int target)
+    {
+        return find_if(routes.begin(), routes.end(),
+                       [&](const Route& r) { return r.source == source  &&  r.target == target; });
+    }
+
+    void evictTo(size_t size)
+    {
+        while (routes.size() > size)
+        {
+            routes.pop_back();
+            stats.evictions++;
+        }
+    }
+};
+
+vector<NavSegment> directionsFor(const string& tag)
+{
+    return vector<NavSegment>(1, NavSegment("left", tag));
+}
+
+bool sameStats(const RouteCacheStats& a, const RouteCacheStats& b)
+{
+    return a.hits == b.hits  &&  a.misses == b.misses  &&  a.evictions == b.evictions  &&
+           a.size == b.size  &&  a.capacity == b.capacity;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    size_t ops = 1000000;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-ops") == 0  &&  i + 1 < argc  &&  atoi(argv[i+1]) > 0)
+            ops = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-seed") == 0  &&  i + 1 < argc  &&  atoi(argv[i+1]) > 0)
+            seed = atoi(argv[++i]);
+        else
+        {
+            cout << "Usage: RouteCacheCheck [-ops N] [-seed S]" << endl;
+            return 1;
+        }
+    }
+
+    RouteCache cache;
+    Model model;
+    mt19937 rng(seed);
+    uniform_int_distribution<int> pickEnd(0, 9);            // 100 routes, more than the largest capacity
+    uniform_int_distribution<int> pickOp(0, 9999);
+    uniform_int_distribution<int> pickCapacity(0, 64);
+    vector<NavSegment> directions;
+    size_t mismatches = 0;
+
+    cache.setCapacity(32);
+    model.capacity = 32;
+
+    for (size_t i = 0; i < ops; i++)
+    {
+        int source = pickEnd(rng);
+        int target = pickEnd(rng);
+        int op = pickOp(rng);
+        if (op < 5000)
+        {
+            auto it = model.find(source, target);
+            bool expected = (model.capacity > 0  &&  it != model.routes.end());
+            bool hit = cache.lookup(source, target, directions);
+            if (hit != expected)
+                mismatches++;
+            if (model.capacity > 0)
+            {
+                if (expected)
+                {
+                    model.stats.hits++;
+                    if (directions.size() != 1  ||  directions[0].m_streetName != it->tag)
+                        mismatches++;
+                    model.routes.splice(model.routes.begin(), model.routes, it);
+                }
+                else
+                    model.stats.misses++;
+            }
+        }
+        else if (op < 9980)
+        {
+            string tag = to_string(i);
+            cache.insert(source, target, directionsFor(tag));
+            if (model.capacity > 0)
+            {
+                auto it = model.find(source, target);
+                if (it != model.routes.end())
+                    model.routes.erase(it);
+                else
+                    model.evictTo(model.capacity - 1);
+                model.routes.push_front(Model::Route{ source, target, tag });
+            }
+        }
+        else if (op < 9995)
+        {
+            size_t capacity = pickCapacity(rng);
+            cache.setCapacity(capacity);
+            model.capacity = capacity;
+            model.evictTo(capacity);
+        }
+        else
+        {
+            cache.clear();
+            model.routes.clear();
+        }
+
+        model.stats.size = model.routes.size();
+        model.stats.capacity = model.capacity;
+        if ( ! sameStats(cache.stats(), model.stats))
+            mismatches++;
+    }
+
+    RouteCacheStats s = cache.stats();
+    cout << ops << " operations: " << s.hits << " hits, " << s.misses << " misses, " << s.evictions
+         << " evictions; " << mismatches << " mismatches" << endl;
+    return mismatches == 0 ? 0 : 1;
+}